@@ -0,0 +1,312 @@
+#include <time.h>
+#include <unistd.h>
+#include "../include/chip8.h"
+#include "../include/frame.h"
+
+/*
+ * Microbenchmarks and end-to-end runs, printed as JSON on stdout.
+ *
+ * Every benchmark is timed over a number of samples, and each sample is
+ * reduced to one value (nanoseconds per operation, or instructions per
+ * second for whole ROMs). The report gives the min, median and 99th
+ * percentile of those values.
+ */
+
+#define BENCH_SAMPLES 31
+#define BENCH_OPERATIONS 100000
+#define BENCH_ROM_FRAMES 100
+#define BENCH_ROM_IPF 1000
+
+typedef struct {
+    const char *name;
+    uint16_t instruction;
+} BENCH_OPCODE;
+
+typedef struct {
+    const char *name;
+    const uint8_t *rom;
+    size_t size;
+} BENCH_ROM;
+
+typedef struct {
+    const char *name;
+    uint8_t backend;
+} BENCH_BACKEND;
+
+// One representative instruction per opcode class
+static const BENCH_OPCODE opcodes[] = {
+    {"ld_byte", 0x6A42}, {"add_byte", 0x7A01}, {"ld_reg", 0x8AB0},
+    {"logic", 0x8AB2},   {"add_reg", 0x8AB4}, {"shift", 0x8AB6},
+    {"skip", 0x3A42},    {"ld_i", 0xA300},    {"jump", 0x1200},
+    {"rnd", 0xCA0F},     {"timers", 0xFA15},  {"add_i", 0xFA1E},
+    {"bcd", 0xFA33},     {"store", 0xF355},   {"load", 0xF365},
+};
+
+// Arithmetic in a tight loop
+static const uint8_t rom_alu[] = {
+    0x70, 0x01,  // 0x200: V0 += 1
+    0x81, 0x04,  // 0x202: V1 += V0
+    0x82, 0x13,  // 0x204: V2 ^= V1
+    0x83, 0x26,  // 0x206: V3 = V2 >> 1
+    0x40, 0x00,  // 0x208: skip if V0 != 0
+    0x74, 0x01,  // 0x20A: V4 += 1
+    0x12, 0x00,  // 0x20C: jump 0x200
+};
+
+// Sprites drawn across the whole screen
+static const uint8_t rom_sprites[] = {
+    0xA2, 0x0A,  // 0x200: I = 0x20A
+    0xD0, 0x18,  // 0x202: draw 8 rows at V0, V1
+    0x70, 0x05,  // 0x204: V0 += 5
+    0x71, 0x03,  // 0x206: V1 += 3
+    0x12, 0x02,  // 0x208: jump 0x202
+    0x3C, 0x42, 0x81, 0xA5, 0x81, 0x99, 0x42, 0x3C,  // 0x20A: sprite
+};
+
+// Subroutine calls with memory stores and loads
+static const uint8_t rom_calls[] = {
+    0x22, 0x06,  // 0x200: call 0x206
+    0x70, 0x01,  // 0x202: V0 += 1
+    0x12, 0x00,  // 0x204: jump 0x200
+    0xA3, 0x00,  // 0x206: I = 0x300
+    0xF0, 0x33,  // 0x208: BCD of V0
+    0xF2, 0x65,  // 0x20A: load V0..V2
+    0x00, 0xEE,  // 0x20C: return
+};
+
+static const BENCH_ROM roms[] = {
+    {"alu", rom_alu, sizeof(rom_alu)},
+    {"sprites", rom_sprites, sizeof(rom_sprites)},
+    {"calls", rom_calls, sizeof(rom_calls)},
+};
+
+static const BENCH_BACKEND backends[] = {
+    {"cached", BACKEND_CACHED},
+    {"switch", BACKEND_SWITCH},
+    {"threaded", BACKEND_THREADED},
+    {"jit", BACKEND_JIT},
+};
+
+static size_t samples = BENCH_SAMPLES;
+static bool first_result = true;
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+  double x = *(const double*)a;
+  double y = *(const double*)b;
+
+  return (x > y) - (x < y);
+}
+
+/**
+ * @brief Prints the summary of one benchmark as a JSON object
+ * @param name: the name of the benchmark
+ * @param unit: the unit of the values
+ * @param values: one value per sample, sorted in place
+ * @returns void
+ */
+static void report(const char* name, const char* unit, double* values) {
+  size_t p99 = (samples * 99 + 99) / 100 - 1;
+
+  qsort(values, samples, sizeof(double), compare_doubles);
+
+  printf("%s\n    {\"name\": \"%s\", \"unit\": \"%s\", \"samples\": %zu, "
+         "\"min\": %.3f, \"median\": %.3f, \"p99\": %.3f}",
+         first_result ? "" : ",", name, unit, samples, values[0],
+         values[samples / 2], values[p99]);
+  first_result = false;
+}
+
+static CHIP8* bench_emulator(uint8_t backend, const uint8_t* rom, size_t size) {
+  CHIP8* emulator = chip8_new();
+  if (emulator == NULL) {
+    perror("Emulator could not be allocated!");
+    exit(EXIT_FAILURE);
+  }
+
+  emulator->backend = backend;
+  if (chip8_load_bytes(emulator, rom, size) == false) {
+    fprintf(stderr, "ROM does not fit in memory!\n");
+    exit(EXIT_FAILURE);
+  }
+
+  return emulator;
+}
+
+static void bench_decode_execute(double* values) {
+  char name[64];
+
+  for (size_t i = 0; i < sizeof(opcodes) / sizeof(opcodes[0]); i++) {
+    CHIP8* emulator = chip8_new();
+
+    for (size_t sample = 0; sample < samples; sample++) {
+      uint64_t start = now_ns();
+      for (size_t n = 0; n < BENCH_OPERATIONS; n++) {
+        emulator->I = 0x300;
+        chip8_decode_execute(emulator, opcodes[i].instruction);
+      }
+      values[sample] = (double)(now_ns() - start) / BENCH_OPERATIONS;
+    }
+
+    snprintf(name, sizeof(name), "decode_execute/%s", opcodes[i].name);
+    report(name, "ns/op", values);
+    chip8_destroy(emulator);
+  }
+}
+
+static void bench_sprites(double* values) {
+  CHIP8* emulator = chip8_new();
+
+  memset(emulator->memory + 0x300, 0xA5, 15);
+  emulator->I = 0x300;
+
+  for (size_t sample = 0; sample < samples; sample++) {
+    uint64_t start = now_ns();
+    for (size_t n = 0; n < BENCH_OPERATIONS; n++) {
+      emulator->V[0] = n * 7;
+      emulator->V[1] = n * 3;
+      chip8_decode_execute(emulator, 0xD01F);
+    }
+    values[sample] = (double)(now_ns() - start) / BENCH_OPERATIONS;
+  }
+
+  report("dxyn/15_rows", "ns/sprite", values);
+  chip8_destroy(emulator);
+}
+
+static void bench_draw(double* values) {
+  uint32_t pixels[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+  uint64_t display[DISPLAY_HEIGHT];
+
+  for (size_t row = 0; row < DISPLAY_HEIGHT; row++) {
+    display[row] = 0x0123456789ABCDEF * (row + 1);
+  }
+
+  for (size_t sample = 0; sample < samples; sample++) {
+    uint64_t start = now_ns();
+    for (size_t n = 0; n < BENCH_OPERATIONS / 100; n++) {
+      display[n % DISPLAY_HEIGHT] ^= n;
+      expand_rows(pixels, DISPLAY_WIDTH * sizeof(uint32_t), display, 0,
+                  DISPLAY_HEIGHT - 1);
+    }
+    values[sample] = (double)(now_ns() - start) / (BENCH_OPERATIONS / 100);
+  }
+
+  report("draw/full_frame", "ns/frame", values);
+}
+
+static void bench_load_rom(double* values) {
+  char file_name[] = "/tmp/chipcraft_bench_XXXXXX";
+  uint8_t rom[MEMORY_SIZE - 0x200];
+  int fd = mkstemp(file_name);
+
+  if (fd < 0) {
+    perror("Temporary ROM could not be created!");
+    return;
+  }
+
+  for (size_t i = 0; i < sizeof(rom); i++) {
+    rom[i] = i * 31;
+  }
+  if (write(fd, rom, sizeof(rom)) != (ssize_t)sizeof(rom)) {
+    perror("Temporary ROM could not be written!");
+  }
+  close(fd);
+
+  CHIP8* emulator = chip8_new();
+  for (size_t sample = 0; sample < samples; sample++) {
+    uint64_t start = now_ns();
+    for (size_t n = 0; n < 100; n++) {
+      chip8_load_rom(emulator, file_name);
+    }
+    values[sample] = (double)(now_ns() - start) / 100;
+  }
+
+  report("load_rom/3584_bytes", "ns/load", values);
+  chip8_destroy(emulator);
+  unlink(file_name);
+}
+
+/**
+ * @brief Runs every synthetic ROM on every backend
+ * @param values: storage for one value per sample
+ * @param instructions_per_frame: the frame length to run at
+ * @param suffix: appended to the benchmark names
+ * @returns void
+ *
+ * Each sample executes about the same number of instructions whatever the
+ * frame length, so short frames show their per-frame overhead.
+ */
+static void bench_roms(double* values, uint16_t instructions_per_frame,
+                       const char* suffix) {
+  uint64_t frames =
+      (uint64_t)BENCH_ROM_FRAMES * BENCH_ROM_IPF / instructions_per_frame;
+  char name[64];
+
+  for (size_t r = 0; r < sizeof(roms) / sizeof(roms[0]); r++) {
+    for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); b++) {
+      CHIP8* emulator =
+          bench_emulator(backends[b].backend, roms[r].rom, roms[r].size);
+      emulator->instructions_per_frame = instructions_per_frame;
+
+      // Warm up caches and compiled code before timing
+      chip8_run_headless(emulator, frames, UINT64_MAX);
+
+      for (size_t sample = 0; sample < samples; sample++) {
+        uint64_t executed = emulator->instructions;
+        uint64_t start = now_ns();
+        chip8_run_headless(emulator, frames, UINT64_MAX);
+        uint64_t elapsed = now_ns() - start;
+        executed = emulator->instructions - executed;
+        values[sample] = executed * 1e9 / (elapsed > 0 ? elapsed : 1);
+      }
+
+      snprintf(name, sizeof(name), "rom/%s/%s%s", roms[r].name,
+               backends[b].name, suffix);
+      report(name, "instructions/s", values);
+      chip8_destroy(emulator);
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+      samples = strtoul(argv[++i], NULL, 0);
+    } else {
+      samples = 0;
+      break;
+    }
+  }
+
+  if (samples == 0) {
+    printf("Usage: %s [--samples <count>]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  double* values = calloc(samples, sizeof(double));
+  if (values == NULL) {
+    perror("Samples could not be allocated!");
+    return EXIT_FAILURE;
+  }
+
+  printf("{\n  \"benchmarks\": [");
+  bench_decode_execute(values);
+  bench_sprites(values);
+  bench_draw(values);
+  bench_load_rom(values);
+  bench_roms(values, BENCH_ROM_IPF, "");
+  bench_roms(values, INSTRUCTIONS_PER_FRAME, "/default_ipf");
+  printf("\n  ]\n}\n");
+
+  free(values);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "chip8.h"
+#include "opcodes.h"
+
+#define AOT_BLOCK_INSTRUCTIONS 64
+#define AOT_ROM_ADDRESS 0x200
+
+/*
+ * A translated block. Returns false if an instruction failed, with the
+ * number of instructions after it that did not run in *unexecuted.
+ */
+typedef bool (*CHIP8_AOT_BLOCK)(CHIP8 *emulator, uint32_t *unexecuted);
+
+typedef struct {
+    // NULL if no block starts at this address
+    CHIP8_AOT_BLOCK run;
+    // 64-byte lines of memory the block was translated from
+    uint64_t lines;
+    uint8_t length;
+} CHIP8_AOT_ENTRY;
+
+typedef struct CHIP8_AOT_PROGRAM {
+    const uint8_t *rom;
+    uint16_t rom_size;
+    // MEMORY_SIZE entries indexed by start address
+    const CHIP8_AOT_ENTRY *blocks;
+} CHIP8_AOT_PROGRAM;
+
+/*
+ * Used by generated code: runs one instruction with constant operands so the
+ * compiler can fold the opcode body into the block.
+ */
+#define CHIP8_AOT_STEP(address, left, body, kind, nnn, x, y, n, nn)            \
+    do {                                                                      \
+        emulator->PC = (address) + 2;                                         \
+        if (body(emulator, &(const CHIP8_OP){NULL, (nnn), (kind), (x), (y),   \
+                                             (n), (nn), (kind)}) == false) {  \
+            *unexecuted = (left);                                             \
+            return false;                                                     \
+        }                                                                     \
+    } while (0)
+
+bool chip8_aot_translate(const uint8_t *rom, size_t size, const char *source,
+                         FILE *out);
+
+bool chip8_aot_load(CHIP8 *emulator, const CHIP8_AOT_PROGRAM *program);
+
+bool chip8_execute_aot(CHIP8 *emulator, uint32_t count);
+
+int chip8_aot_main(const CHIP8_AOT_PROGRAM *program, int argc, char *argv[]);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define AUDIO_FREQUENCY 44100
+// Pitch of the beep in Hz
+#define AUDIO_TONE 440
+#define AUDIO_AMPLITUDE 3000
+// Samples per callback. Smaller buffers start and stop the beep sooner but
+// underrun more easily on a loaded host.
+#define AUDIO_BUFFER_DEFAULT 512
+#define AUDIO_BUFFER_MIN 64
+#define AUDIO_BUFFER_MAX 8192
+
+/*
+ * Square wave beeper. The emulation thread only flips playing, and the
+ * audio callback reads it once per buffer.
+ */
+typedef struct {
+    SDL_AudioDeviceID device;
+    // Set while the sound timer is running
+    atomic_bool playing;
+    // Owned by the audio callback: position in the wave, where a full
+    // turn of the 32-bit counter is one period
+    uint32_t phase;
+    uint32_t step;
+} CHIP8_AUDIO;
+
+bool audio_open(CHIP8_AUDIO *audio, uint16_t samples);
+
+void audio_close(CHIP8_AUDIO *audio);
+
+void audio_fill(CHIP8_AUDIO *audio, int16_t *samples, size_t count);
+
+/**
+ * @brief Starts or stops the beep
+ * @param audio: a pointer to the beeper
+ * @param playing: whether the sound timer is running
+ * @returns void
+ */
+static inline void audio_set(CHIP8_AUDIO *audio, bool playing) {
+    atomic_store_explicit(&audio->playing, playing, memory_order_relaxed);
+}
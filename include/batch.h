@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdatomic.h>
+#include "chip8.h"
+#include "romlib.h"
+
+/*
+ * One ROM of a batch and, once it has run, its result
+ */
+typedef struct {
+    // Shown in the result line, and read from disk if rom is NULL
+    const char *name;
+    const CHIP8_ROM *rom;
+
+    bool loaded;
+    // Set when an instruction failed, which ends the run
+    bool failed;
+    uint16_t error_address;
+    uint16_t error_opcode;
+    uint64_t instructions;
+    uint64_t frames;
+    // FNV-1a hash of the final display, rows top to bottom little-endian
+    uint64_t display_hash;
+    double seconds;
+
+    // Set by the worker that ran the job, read by the one printing it
+    atomic_bool done;
+} CHIP8_BATCH_JOB;
+
+typedef struct {
+    uint64_t frames;
+    uint64_t cycles;
+    uint16_t instructions_per_frame;
+    uint8_t backend;
+    uint32_t seed;
+    bool busy_wait;
+    // Worker threads, 0 for one per online core
+    unsigned threads;
+} CHIP8_BATCH_CONFIG;
+
+uint64_t chip8_display_hash(const CHIP8 *emulator);
+
+void chip8_batch_print(FILE *out, const CHIP8_BATCH_JOB *job);
+
+size_t chip8_batch_run(CHIP8_BATCH_JOB *jobs, size_t count,
+                       const CHIP8_BATCH_CONFIG *config, FILE *out);
@@ -4,7 +4,6 @@
 
 #pragma once
 
-#include <SDL2/SDL.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -12,7 +11,8 @@
 #include <string.h>
 #include <sys/stat.h>
 #include "../include/log.h"
-#include "graphics.h"
+#include "log_async.h"
+#include "stats.h"
 
 #define MEMORY_SIZE 4096
 #define V_REGISTERS_SIZE 16
@@ -20,6 +20,16 @@
 #define KEYPAD_SIZE 16
 #define DISPLAY_WIDTH 64
 #define DISPLAY_HEIGHT 32
+#define FRAME_RATE 60
+#define INSTRUCTIONS_PER_FRAME 11
+#define HEADLESS_FRAMES 3600
+#define RUN_AHEAD_MAX 8
+// Fastest fast-forward, in emulated frames per 60 Hz frame
+#define SPEED_MAX 64
+// Runs as many frames as fit before each 60 Hz deadline
+#define SPEED_UNCAPPED 0
+// Seed of the random number generator unless one is configured
+#define RANDOM_SEED 0x2545F491
 
 typedef struct {
     size_t top;
@@ -32,11 +42,49 @@ typedef struct {
  */
 STACK *stack_new(void);
 
+void stack_init(STACK *stack);
+
+void stack_destroy(STACK *stack);
+
 bool stack_push(STACK *stack, uint16_t input);
 
 bool stack_pop(STACK *stack, uint16_t *popped);
 
-typedef struct {
+struct CHIP8;
+struct CHIP8_OP;
+struct CHIP8_JIT;
+struct CHIP8_AOT_PROGRAM;
+struct CHIP8_PROFILE;
+struct CHIP8_ROM;
+
+typedef bool (*CHIP8_HANDLER)(struct CHIP8 *emulator,
+                              const struct CHIP8_OP *op);
+
+/*
+ * A predecoded instruction with its handler and operands resolved
+ */
+typedef struct CHIP8_OP {
+    // NULL until the address has been decoded
+    CHIP8_HANDLER handler;
+    uint16_t nnn;
+    uint8_t kind;
+    uint8_t x;
+    uint8_t y;
+    uint8_t n;
+    uint8_t nn;
+    // Threaded-code entry, which is kind unless fused with the next op
+    uint8_t dispatch;
+} CHIP8_OP;
+
+typedef enum {
+    BACKEND_CACHED,
+    BACKEND_SWITCH,
+    BACKEND_THREADED,
+    BACKEND_JIT,
+    BACKEND_AOT,
+} CHIP8_BACKEND;
+
+typedef struct CHIP8 {
     // CPU registers (V0 - VF)
     uint8_t V[V_REGISTERS_SIZE];
 
@@ -47,8 +95,7 @@ typedef struct {
     uint16_t PC;
 
     // Stack
-    STACK *stack;
-    uint8_t SP;
+    STACK stack;
 
     // Memory (4 KB)
     uint8_t memory[MEMORY_SIZE];
@@ -57,13 +104,48 @@ typedef struct {
     uint8_t delay_timer;
     uint8_t sound_timer;
 
+    // Random number generator (xorshift32) and the seed it starts from at
+    // reset, both never zero. See chip8_seed().
+    uint32_t random;
+    uint32_t seed;
+
     // Input
     bool keypad[KEYPAD_SIZE];
-    uint16_t keymap[KEYPAD_SIZE][2];
 
-    // Display (64x32)
-    bool display[DISPLAY_WIDTH][DISPLAY_HEIGHT];
-    bool draw_flag;
+    // Display (64x32), one word per row with column 0 in the top bit
+    uint64_t display[DISPLAY_HEIGHT];
+    // One bit per row changed since the last draw
+    uint32_t dirty_rows;
+
+    // Scheduling
+    uint16_t instructions_per_frame;
+    uint8_t backend;
+    uint64_t instructions;
+    uint64_t frames;
+    // Runs idle loops instruction by instruction instead of skipping them,
+    // see chip8_idle_skip()
+    bool busy_wait;
+    // Instructions counted in instructions without being executed
+    uint64_t idle_instructions;
+
+    // Predecoded instructions, one per address. Anything that writes to
+    // memory must call chip8_invalidate() so stale entries are decoded again.
+    CHIP8_OP ops[MEMORY_SIZE];
+
+    // One bit per 64-byte line of memory written since the last full load
+    uint64_t dirty_lines;
+
+    // Compiled blocks, created the first time the JIT backend runs
+    struct CHIP8_JIT *jit;
+    // Set when the JIT could not be created, so it is not tried again
+    bool jit_failed;
+
+    // Translated ROM for the AOT backend, see chip8_aot_load()
+    const struct CHIP8_AOT_PROGRAM *aot;
+
+    // Counts every instruction when set, see chip8_execute_profiled().
+    // Freed with the emulator.
+    struct CHIP8_PROFILE *profile;
 } CHIP8;
 
 /*
@@ -71,16 +153,32 @@ typedef struct {
  */
 CHIP8 *chip8_new(void);
 
-void chip8_run(char *file_name);
+void chip8_destroy(CHIP8 *emulator);
 
-void chip8_load_fonts(CHIP8 *emulator);
+void chip8_reset(CHIP8 *emulator);
+
+void chip8_seed(CHIP8 *emulator, uint32_t seed);
 
-void chip8_load_keymap(CHIP8 *emulator);
+bool chip8_run_headless(CHIP8 *emulator, uint64_t frames, uint64_t cycles);
+
+bool chip8_execute(CHIP8 *emulator, uint32_t count);
+
+bool chip8_execute_cached(CHIP8 *emulator, uint32_t count);
+
+bool chip8_run_frame(CHIP8 *emulator);
+
+uint8_t chip8_speed_step(uint8_t speed, bool faster);
+
+bool chip8_parse_backend(const char *name, uint8_t *backend);
+
+void chip8_load_fonts(CHIP8 *emulator);
 
 bool chip8_load_rom(CHIP8 *emulator, char *file_name);
 
+bool chip8_load_bytes(CHIP8 *emulator, const uint8_t *data, size_t size);
+
 uint16_t chip8_fetch(CHIP8 *emulator);
 
-bool chip8_decode_execute(CHIP8 *emulator, uint16_t instruction);
+void chip8_invalidate(CHIP8 *emulator, uint16_t address, uint16_t length);
 
-void chip8_draw(CHIP8 *emulator, SDL_Texture *screen, SDL_Renderer *renderer);
+bool chip8_decode_execute(CHIP8 *emulator, uint16_t instruction);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdatomic.h>
+#include "chip8.h"
+
+// Set in the shared index when it holds a frame the consumer has not taken
+#define FRAME_FRESH 0x4
+
+typedef struct {
+    uint64_t rows[DISPLAY_HEIGHT];
+    // Number of the emulated frame this was captured at
+    uint64_t sequence;
+} CHIP8_FRAME;
+
+/*
+ * Single-producer, single-consumer triple buffer. The producer always has a
+ * buffer to write and the consumer always has the newest complete frame, and
+ * neither ever waits on the other: they only swap indices atomically.
+ */
+typedef struct {
+    CHIP8_FRAME buffers[3];
+    // Buffer index shared between both sides, plus FRAME_FRESH
+    atomic_uint_fast8_t middle;
+    // Owned by the producer
+    uint8_t back;
+    // Owned by the consumer
+    uint8_t front;
+} CHIP8_FRAME_BUFFER;
+
+void frame_buffer_init(CHIP8_FRAME_BUFFER *buffer);
+
+CHIP8_FRAME *frame_buffer_back(CHIP8_FRAME_BUFFER *buffer);
+
+void frame_buffer_publish(CHIP8_FRAME_BUFFER *buffer);
+
+bool frame_buffer_acquire(CHIP8_FRAME_BUFFER *buffer, const CHIP8_FRAME **frame);
+
+void expand_rows(void *pixels, int pitch, const uint64_t *display, int first, int last);
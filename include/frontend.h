@@ -0,0 +1,43 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include "chip8.h"
+#include "graphics.h"
+
+/*
+ * The SDL window, keyboard and audio around the emulator. Nothing in
+ * chip8.h needs SDL, so headless code only includes that.
+ */
+
+typedef struct {
+    // Instructions executed per 60 Hz frame
+    uint16_t instructions_per_frame;
+
+    // Interpreter backend (CHIP8_BACKEND)
+    uint8_t backend;
+
+    // Frames to run ahead of the present before showing one, 0 to disable
+    uint8_t run_ahead;
+
+    // File to write a folded-stack profile to on exit, or NULL
+    const char *profile;
+
+    // Seed of the random number generator, 0 for RANDOM_SEED
+    uint32_t seed;
+
+    // File to record an input movie to on exit, or NULL
+    const char *record;
+
+    // Executes idle loops instead of fast-forwarding through them
+    bool busy_wait;
+
+    // Audio buffer size in samples, 0 for AUDIO_BUFFER_DEFAULT
+    uint16_t audio_buffer;
+
+    // ROM from a library to load instead of the file, or NULL
+    const struct CHIP8_ROM *rom;
+} CHIP8_CONFIG;
+
+void chip8_run(char *file_name, const CHIP8_CONFIG *config);
+
+void chip8_draw(CHIP8 *emulator, SDL_Texture *screen, SDL_Renderer *renderer);
@@ -13,4 +13,9 @@ void initialize_graphics(SDL_Texture **screen, SDL_Renderer **renderer, SDL_Wind
 
 void deinitialize_graphics(SDL_Texture *screen, SDL_Renderer *renderer, SDL_Window *window);
 
-void update_graphics(SDL_Texture *screen, SDL_Renderer *renderer, uint32_t *pixels);
\ No newline at end of file
+void draw_graphics(SDL_Texture *screen, const uint64_t *display, uint32_t dirty_rows);
+
+void present_graphics(SDL_Texture *screen, SDL_Renderer *renderer, SDL_Texture *overlay);
+
+void update_graphics(SDL_Texture *screen, SDL_Renderer *renderer, const uint64_t *display,
+                     uint32_t dirty_rows);
\ No newline at end of file
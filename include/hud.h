@@ -0,0 +1,74 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Overlay texture, scaled over the whole display
+#define HUD_WIDTH 160
+#define HUD_HEIGHT 80
+// Glyphs are 3x5 pixels with a pixel of spacing
+#define HUD_CELL_WIDTH 4
+#define HUD_CELL_HEIGHT 6
+#define HUD_LINES 7
+#define HUD_COLUMNS 16
+// Times per second the numbers are refreshed
+#define HUD_UPDATE_RATE 4
+#define HUD_TEXT_COLOR 0xFFFFFFFF
+#define HUD_PANEL_COLOR 0x000000C0
+
+/*
+ * Running totals the HUD takes its numbers from. Each one only grows, so
+ * two snapshots give the rates over the time between them.
+ */
+typedef struct {
+    // Performance counter ticks when the snapshot was taken
+    uint64_t time;
+    uint64_t instructions;
+    uint64_t frames;
+    // Frames that finished after their 60 Hz deadline
+    uint64_t dropped;
+    // Performance counter ticks spent in each phase
+    uint64_t execute_ticks;
+    uint64_t draw_ticks;
+    uint64_t present_ticks;
+    uint64_t presents;
+    // Speed aimed for rather than a total, see chip8_speed_step()
+    uint8_t speed;
+} CHIP8_HUD_COUNTERS;
+
+typedef struct {
+    double instructions_per_second;
+    // Average milliseconds per frame in each phase
+    double execute_ms;
+    double draw_ms;
+    double present_ms;
+    uint64_t dropped;
+    // Emulated frames per second relative to FRAME_RATE
+    double speed;
+    // Speed aimed for, SPEED_UNCAPPED for none
+    uint8_t limit;
+} CHIP8_HUD_STATS;
+
+typedef struct {
+    SDL_Texture *texture;
+    uint64_t frequency;
+    CHIP8_HUD_COUNTERS previous;
+    bool visible;
+    uint32_t pixels[HUD_HEIGHT * HUD_WIDTH];
+} CHIP8_HUD;
+
+bool hud_init(CHIP8_HUD *hud, SDL_Renderer *renderer);
+
+void hud_destroy(CHIP8_HUD *hud);
+
+void hud_compute(const CHIP8_HUD_COUNTERS *previous,
+                 const CHIP8_HUD_COUNTERS *current, uint64_t frequency,
+                 CHIP8_HUD_STATS *stats);
+
+void hud_format(const CHIP8_HUD_STATS *stats,
+                char lines[HUD_LINES][HUD_COLUMNS + 1]);
+
+void hud_print(uint32_t *pixels, int x, int y, const char *text);
+
+bool hud_sample(CHIP8_HUD *hud, const CHIP8_HUD_COUNTERS *current);
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "chip8.h"
+
+// Longest loop, in instructions, that is recognized as idle
+#define IDLE_LOOP_MAX 8
+// Instructions executed between checks for an idle loop
+#define IDLE_PROBE_INTERVAL 512
+// Fewest instructions left in a frame for a loop to be skipped at all: one
+// pass to recognize it and one more to skip
+#define IDLE_PROBE_MIN 2
+
+uint32_t chip8_idle_skip(CHIP8 *emulator, uint32_t remaining, bool *success);
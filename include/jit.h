@@ -0,0 +1,23 @@
+#pragma once
+
+#include "chip8.h"
+
+// Executions of an address before a block starting there is compiled
+#define JIT_HOT_THRESHOLD 16
+// Times a block may be thrown out by writes into it before it is left to
+// the interpreter for good
+#define JIT_SMC_LIMIT 4
+#define JIT_BLOCK_INSTRUCTIONS 32
+#define JIT_CODE_SIZE (256 * 1024)
+
+typedef struct CHIP8_JIT CHIP8_JIT;
+
+CHIP8_JIT *chip8_jit_new(void);
+
+void chip8_jit_destroy(CHIP8_JIT *jit);
+
+void chip8_jit_flush(CHIP8_JIT *jit);
+
+void chip8_jit_invalidate(CHIP8_JIT *jit, uint16_t address, uint16_t length);
+
+bool chip8_execute_jit(CHIP8 *emulator, uint32_t count);
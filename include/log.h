@@ -33,12 +33,56 @@ enum {
     LOG_TRACE, LOG_DEBUG, LOG_INFO, LOG_WARN, LOG_ERROR, LOG_FATAL
 };
 
-#define log_trace(...) log_log(LOG_TRACE, __FILE__, __LINE__, __VA_ARGS__)
-#define log_debug(...) log_log(LOG_DEBUG, __FILE__, __LINE__, __VA_ARGS__)
-#define log_info(...)  log_log(LOG_INFO,  __FILE__, __LINE__, __VA_ARGS__)
-#define log_warn(...)  log_log(LOG_WARN,  __FILE__, __LINE__, __VA_ARGS__)
-#define log_error(...) log_log(LOG_ERROR, __FILE__, __LINE__, __VA_ARGS__)
-#define log_fatal(...) log_log(LOG_FATAL, __FILE__, __LINE__, __VA_ARGS__)
+/*
+ * Call sites below LOG_MIN_LEVEL are removed by the preprocessor. It is a
+ * number rather than the enum so #if can see it: 0 keeps everything, 2
+ * starts at LOG_INFO, 6 removes every call.
+ */
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+/*
+ * The lowest level any output would accept, kept up to date by the setters
+ * below. Call sites compare against it before evaluating their arguments.
+ */
+extern int log_threshold;
+
+#define LOG_AT(level, ...) \
+    ((level) >= log_threshold \
+         ? log_log((level), __FILE__, __LINE__, __VA_ARGS__) : (void) 0)
+#define LOG_DISCARD(...) ((void) 0)
+
+#if LOG_MIN_LEVEL <= 0
+#define log_trace(...) LOG_AT(LOG_TRACE, __VA_ARGS__)
+#else
+#define log_trace(...) LOG_DISCARD(__VA_ARGS__)
+#endif
+#if LOG_MIN_LEVEL <= 1
+#define log_debug(...) LOG_AT(LOG_DEBUG, __VA_ARGS__)
+#else
+#define log_debug(...) LOG_DISCARD(__VA_ARGS__)
+#endif
+#if LOG_MIN_LEVEL <= 2
+#define log_info(...)  LOG_AT(LOG_INFO,  __VA_ARGS__)
+#else
+#define log_info(...)  LOG_DISCARD(__VA_ARGS__)
+#endif
+#if LOG_MIN_LEVEL <= 3
+#define log_warn(...)  LOG_AT(LOG_WARN,  __VA_ARGS__)
+#else
+#define log_warn(...)  LOG_DISCARD(__VA_ARGS__)
+#endif
+#if LOG_MIN_LEVEL <= 4
+#define log_error(...) LOG_AT(LOG_ERROR, __VA_ARGS__)
+#else
+#define log_error(...) LOG_DISCARD(__VA_ARGS__)
+#endif
+#if LOG_MIN_LEVEL <= 5
+#define log_fatal(...) LOG_AT(LOG_FATAL, __VA_ARGS__)
+#else
+#define log_fatal(...) LOG_DISCARD(__VA_ARGS__)
+#endif
 
 const char *log_level_string(int level);
 
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "log.h"
+
+// Events each logging thread can have queued before new ones are dropped
+#define LOG_ASYNC_RING_SIZE 4096
+#define LOG_ASYNC_ARGS 4
+// How long the writer sleeps when every ring is empty
+#define LOG_ASYNC_IDLE_NS 1000000
+
+/*
+ * The lowest level recorded, or above LOG_FATAL while the writer is not
+ * running. Call sites check it inline before evaluating their arguments.
+ */
+extern atomic_int log_async_threshold;
+
+bool log_async_start(FILE *fp, int level);
+
+void log_async_stop(void);
+
+void log_async_set_level(int level);
+
+uint64_t log_async_dropped(void);
+
+/*
+ * Records an event without formatting it. Arguments are stored as integers
+ * and formatted later on the writer thread, so formats may only use ll
+ * conversions such as %llu and %llX, and must be string literals.
+ */
+void log_async_write(int level, const char *file, int line, const char *fmt,
+                     uint8_t count, uint64_t a, uint64_t b, uint64_t c,
+                     uint64_t d);
+
+/*
+ * Picks log_async_N for the N arguments after the format. The trailing 0
+ * keeps the variadic part of LOG_ASYNC_COUNT_ from ever being empty.
+ */
+#define LOG_ASYNC_COUNT_(fmt, a, b, c, d, n, ...) n
+#define LOG_ASYNC_COUNT(...) LOG_ASYNC_COUNT_(__VA_ARGS__, 4, 3, 2, 1, 0, 0)
+#define LOG_ASYNC_CAT_(a, b) a##b
+#define LOG_ASYNC_CAT(a, b) LOG_ASYNC_CAT_(a, b)
+
+#define log_async_0(level, fmt) \
+    log_async_write(level, __FILE__, __LINE__, fmt, 0, 0, 0, 0, 0)
+#define log_async_1(level, fmt, a) \
+    log_async_write(level, __FILE__, __LINE__, fmt, 1, (a), 0, 0, 0)
+#define log_async_2(level, fmt, a, b) \
+    log_async_write(level, __FILE__, __LINE__, fmt, 2, (a), (b), 0, 0)
+#define log_async_3(level, fmt, a, b, c) \
+    log_async_write(level, __FILE__, __LINE__, fmt, 3, (a), (b), (c), 0)
+#define log_async_4(level, fmt, a, b, c, d) \
+    log_async_write(level, __FILE__, __LINE__, fmt, 4, (a), (b), (c), (d))
+
+#define log_async(level, ...)                                               \
+    ((level) >= atomic_load_explicit(&log_async_threshold,                  \
+                                     memory_order_relaxed)                  \
+         ? LOG_ASYNC_CAT(log_async_, LOG_ASYNC_COUNT(__VA_ARGS__))(level,   \
+                                                               __VA_ARGS__) \
+         : (void) 0)
+
+// Levels below LOG_MIN_LEVEL are removed at compile time, as in log.h
+#if LOG_MIN_LEVEL <= 0
+#define log_async_trace(...) log_async(LOG_TRACE, __VA_ARGS__)
+#else
+#define log_async_trace(...) LOG_DISCARD(__VA_ARGS__)
+#endif
+#if LOG_MIN_LEVEL <= 1
+#define log_async_debug(...) log_async(LOG_DEBUG, __VA_ARGS__)
+#else
+#define log_async_debug(...) LOG_DISCARD(__VA_ARGS__)
+#endif
+#if LOG_MIN_LEVEL <= 2
+#define log_async_info(...)  log_async(LOG_INFO,  __VA_ARGS__)
+#else
+#define log_async_info(...)  LOG_DISCARD(__VA_ARGS__)
+#endif
+#if LOG_MIN_LEVEL <= 3
+#define log_async_warn(...)  log_async(LOG_WARN,  __VA_ARGS__)
+#else
+#define log_async_warn(...)  LOG_DISCARD(__VA_ARGS__)
+#endif
+#if LOG_MIN_LEVEL <= 4
+#define log_async_error(...) log_async(LOG_ERROR, __VA_ARGS__)
+#else
+#define log_async_error(...) LOG_DISCARD(__VA_ARGS__)
+#endif
+#if LOG_MIN_LEVEL <= 5
+#define log_async_fatal(...) log_async(LOG_FATAL, __VA_ARGS__)
+#else
+#define log_async_fatal(...) LOG_DISCARD(__VA_ARGS__)
+#endif
@@ -9,4 +9,10 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include "audio.h"
 #include "chip8.h"
+#include "frontend.h"
+#include "movie.h"
+#include "profiler.h"
+#include "romlib.h"
+#include "state.h"
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "chip8.h"
+#include "state.h"
+
+#define MOVIE_MAGIC "C8MV"
+#define MOVIE_VERSION 2
+
+/*
+ * Movie file layout, all fields little-endian:
+ *
+ *   0   magic "C8MV"       4    version, reserved    8    seed (u32)
+ *   12  instructions per frame, reserved             16   ROM hash (u64)
+ *   24  frames (u64)       32   final state hash     40   event count (u64)
+ *   48  events, each a frame number (u64), keypad bitmask (u16), reserved
+ *
+ * Version 1 events are 8 bytes with a u32 frame number, and still load.
+ */
+#define MOVIE_HEADER_SIZE 48
+#define MOVIE_EVENT_SIZE 16
+#define MOVIE_EVENT_SIZE_V1 8
+
+typedef struct {
+    // Frame the keypad changed before
+    uint64_t frame;
+    // One bit per key, key 0 in bit 0
+    uint16_t keys;
+} CHIP8_MOVIE_EVENT;
+
+/*
+ * Keypad input by frame number, from power-on with a known seed and ROM.
+ * Replaying it on any backend reproduces the recorded run exactly.
+ */
+typedef struct {
+    uint32_t seed;
+    uint16_t instructions_per_frame;
+    // FNV-1a hash of the memory the run started from
+    uint64_t rom_hash;
+    uint64_t frames;
+    uint64_t state_hash;
+
+    CHIP8_MOVIE_EVENT *events;
+    size_t count;
+    size_t capacity;
+} CHIP8_MOVIE;
+
+CHIP8_MOVIE *chip8_movie_new(const CHIP8 *emulator);
+
+void chip8_movie_destroy(CHIP8_MOVIE *movie);
+
+bool chip8_movie_record(CHIP8_MOVIE *movie, uint64_t frame, uint16_t keys);
+
+void chip8_movie_finish(CHIP8_MOVIE *movie, const CHIP8 *emulator);
+
+bool chip8_movie_save(const CHIP8_MOVIE *movie, const char *file_name);
+
+CHIP8_MOVIE *chip8_movie_load(const char *file_name);
+
+bool chip8_movie_start(CHIP8 *emulator, const CHIP8_MOVIE *movie);
+
+bool chip8_movie_replay(CHIP8 *emulator, const CHIP8_MOVIE *movie);
@@ -0,0 +1,387 @@
+#pragma once
+
+#include "chip8.h"
+
+/*
+ * Every instruction form the interpreter understands. A decoded CHIP8_OP
+ * stores one of these in its kind field.
+ */
+typedef enum {
+    OP_CLS,        // 00E0
+    OP_RET,        // 00EE
+    OP_SYS,        // 0NNN
+    OP_JP,         // 1NNN
+    OP_CALL,       // 2NNN
+    OP_SE_BYTE,    // 3XNN
+    OP_SNE_BYTE,   // 4XNN
+    OP_SE_REG,     // 5XY0
+    OP_LD_BYTE,    // 6XNN
+    OP_ADD_BYTE,   // 7XNN
+    OP_LD_REG,     // 8XY0
+    OP_OR,         // 8XY1
+    OP_AND,        // 8XY2
+    OP_XOR,        // 8XY3
+    OP_ADD_REG,    // 8XY4
+    OP_SUB,        // 8XY5
+    OP_SHR,        // 8XY6
+    OP_SUBN,       // 8XY7
+    OP_SHL,        // 8XYE
+    OP_SNE_REG,    // 9XY0
+    OP_LD_I,       // ANNN
+    OP_JP_V0,      // BNNN
+    OP_RND,        // CXNN
+    OP_DRW,        // DXYN
+    OP_SKP,        // EX9E
+    OP_SKNP,       // EXA1
+    OP_LD_VX_DT,   // FX07
+    OP_LD_VX_K,    // FX0A
+    OP_LD_DT_VX,   // FX15
+    OP_LD_ST_VX,   // FX18
+    OP_ADD_I_VX,   // FX1E
+    OP_LD_F_VX,    // FX29
+    OP_LD_B_VX,    // FX33
+    OP_LD_I_VX,    // FX55
+    OP_LD_VX_I,    // FX65
+    OP_INVALID,
+    OP_COUNT
+} CHIP8_OPCODE;
+
+/*
+ * Threaded-code entries beyond the plain instruction forms: superinstructions
+ * that execute two adjacent instructions at once, and the entry for an
+ * address that has not been decoded yet.
+ */
+typedef enum {
+    FUSED_LD_LD = OP_COUNT,  // 6XNN 6YNN
+    FUSED_ADD_SE,            // 7XNN 3YNN
+    FUSED_LD_I_DRW,          // ANNN DXYN
+    DISPATCH_DECODE,
+    DISPATCH_COUNT
+} CHIP8_DISPATCH;
+
+/*
+ * Decoding
+ */
+void chip8_decode(uint16_t instruction, CHIP8_OP *op);
+
+extern const CHIP8_HANDLER chip8_handlers[OP_COUNT];
+
+extern const char *const chip8_opcode_names[OP_COUNT];
+
+/*
+ * Instruction bodies
+ *
+ * Each body runs after PC has already been advanced past the instruction,
+ * exactly like chip8_decode_execute() used to. They live in the header so
+ * every interpreter backend inlines the same code.
+ */
+static inline bool chip8_op_cls(CHIP8 *emulator, const CHIP8_OP *op) {
+    (void) op;
+    log_async_trace("0x00E0 - Clearing screen");
+    memset(emulator->display, 0, sizeof(emulator->display));
+    emulator->dirty_rows = UINT32_MAX;
+    return true;
+}
+
+static inline bool chip8_op_ret(CHIP8 *emulator, const CHIP8_OP *op) {
+    (void) op;
+    log_async_trace("0x00EE - Returning from subroutine");
+    uint16_t pc = 0;
+
+    if (stack_pop(&emulator->stack, &pc) == false) {
+        return false;
+    }
+
+    emulator->PC = pc;
+    return true;
+}
+
+static inline bool chip8_op_sys(CHIP8 *emulator, const CHIP8_OP *op) {
+    (void) emulator;
+    (void) op;
+    // This case doesn't matter for modern CHIP-8 emulators
+    log_async_trace("0x0%03llX - Unnecessary instruction", op->nnn);
+    return true;
+}
+
+static inline bool chip8_op_jp(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("0x1NNN - Jumping to 0x%03llX", op->nnn);
+    emulator->PC = op->nnn;
+    return true;
+}
+
+static inline bool chip8_op_call(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("0x2NNN - Calling a subroutine");
+    if (stack_push(&emulator->stack, emulator->PC) == false) {
+        return false;
+    }
+
+    emulator->PC = op->nnn;
+    return true;
+}
+
+static inline bool chip8_op_se_byte(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("0x3XNN - Skipping if VX equals NN");
+    if (emulator->V[op->x] == op->nn) {
+        emulator->PC += 2;
+    }
+    return true;
+}
+
+static inline bool chip8_op_sne_byte(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("0x4XNN - Skipping if VX does not equal NN");
+    if (emulator->V[op->x] != op->nn) {
+        emulator->PC += 2;
+    }
+    return true;
+}
+
+static inline bool chip8_op_se_reg(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("0x5XY0 - Skipping if VX equals VY");
+    if (emulator->V[op->x] == emulator->V[op->y]) {
+        emulator->PC += 2;
+    }
+    return true;
+}
+
+static inline bool chip8_op_ld_byte(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("0x6XNN - Setting VX to NN");
+    emulator->V[op->x] = op->nn;
+    return true;
+}
+
+static inline bool chip8_op_add_byte(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("0x7XNN - Adding NN to VX");
+    emulator->V[op->x] += op->nn;
+    return true;
+}
+
+static inline bool chip8_op_ld_reg(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("8XY0: Setting VX to VY");
+    emulator->V[op->x] = emulator->V[op->y];
+    return true;
+}
+
+static inline bool chip8_op_or(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("8XY1: Binary OR of VX and VY");
+    emulator->V[op->x] |= emulator->V[op->y];
+    emulator->V[0xF] = 0;
+    return true;
+}
+
+static inline bool chip8_op_and(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("8XY2: Binary AND of VX and VY");
+    emulator->V[op->x] &= emulator->V[op->y];
+    emulator->V[0xF] = 0;
+    return true;
+}
+
+static inline bool chip8_op_xor(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("8XY3: Binary XOR of VX and VY");
+    emulator->V[op->x] ^= emulator->V[op->y];
+    emulator->V[0xF] = 0;
+    return true;
+}
+
+static inline bool chip8_op_add_reg(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("8XY4: Adding VX and VY");
+    bool flag = (emulator->V[op->x] + emulator->V[op->y]) > 0xFF;
+    emulator->V[op->x] += emulator->V[op->y];
+    emulator->V[0xF] = flag;
+    return true;
+}
+
+static inline bool chip8_op_sub(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("8XY5: Subtracting VY from VX");
+    bool flag = emulator->V[op->x] >= emulator->V[op->y];
+    emulator->V[op->x] -= emulator->V[op->y];
+    emulator->V[0xF] = flag;
+    return true;
+}
+
+static inline bool chip8_op_shr(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("8XY6: Shifting right");
+    const uint8_t shft_r = emulator->V[op->y] & 0x01;
+    emulator->V[op->x] = emulator->V[op->y] >> 1;
+    emulator->V[0xF] = shft_r;
+    return true;
+}
+
+static inline bool chip8_op_subn(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("8XY7: Subtracting VX from VY");
+    bool flag = emulator->V[op->y] >= emulator->V[op->x];
+    emulator->V[op->x] = emulator->V[op->y] - emulator->V[op->x];
+    emulator->V[0xF] = flag;
+    return true;
+}
+
+static inline bool chip8_op_shl(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("8XYE: Shifting left");
+    const uint8_t shft_l = (emulator->V[op->y] & 0x80) >> 7;
+    emulator->V[op->x] = emulator->V[op->y] << 1;
+    emulator->V[0xF] = shft_l;
+    return true;
+}
+
+static inline bool chip8_op_sne_reg(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("0x9XY0 - Skipping if VX does not equal VY");
+    if (emulator->V[op->x] != emulator->V[op->y]) {
+        emulator->PC += 2;
+    }
+    return true;
+}
+
+static inline bool chip8_op_ld_i(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("0xANNN - Setting index register to NNN");
+    emulator->I = op->nnn;
+    return true;
+}
+
+static inline bool chip8_op_jp_v0(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("0xBNNN - Jumping with offset");
+    emulator->PC += op->nnn + emulator->V[0];
+    return true;
+}
+
+/*
+ * Steps the emulator's xorshift32 generator and returns its top byte, the
+ * best mixed one
+ */
+static inline uint8_t chip8_random(CHIP8 *emulator) {
+    uint32_t x = emulator->random;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    emulator->random = x;
+
+    return x >> 24;
+}
+
+static inline bool chip8_op_rnd(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("0xCXNN - Generating random number");
+    emulator->V[op->x] = chip8_random(emulator) & op->nn;
+    return true;
+}
+
+static inline bool chip8_op_drw(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("0xDXYN - Displaying sprite");
+    // This can be done with modulo, but bitwise AND should be the same speed or better in most cases
+    uint8_t xc = emulator->V[op->x] & 63;
+    uint8_t yc = emulator->V[op->y] & 31;
+    uint64_t collision = 0;
+
+    // The start position wraps, but sprites are clipped at the edges: bits
+    // shifted past column 63 fall off the end of the row.
+    for (size_t row = 0; row < op->n && yc + row < DISPLAY_HEIGHT; row++) {
+        uint64_t sprite =
+            (uint64_t) emulator->memory[(emulator->I + row) & 0xFFF] << 56 >> xc;
+        collision |= emulator->display[yc + row] & sprite;
+        emulator->display[yc + row] ^= sprite;
+        if (sprite != 0) {
+            emulator->dirty_rows |= UINT32_C(1) << (yc + row);
+        }
+    }
+    emulator->V[0xF] = collision != 0;
+    return true;
+}
+
+static inline bool chip8_op_skp(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("EX9E: Skipping if key is pressed");
+    if (emulator->keypad[emulator->V[op->x] & 0xF] == true) {
+        emulator->PC += 2;
+    }
+    return true;
+}
+
+static inline bool chip8_op_sknp(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("EXA1: Skipping if key is not pressed");
+    if (emulator->keypad[emulator->V[op->x] & 0xF] == false) {
+        emulator->PC += 2;
+    }
+    return true;
+}
+
+static inline bool chip8_op_ld_vx_dt(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("FX07: Setting VX to the delay timer");
+    emulator->V[op->x] = emulator->delay_timer;
+    return true;
+}
+
+static inline bool chip8_op_ld_vx_k(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("FX0A: Waiting for keypress");
+    for (size_t i = 0; i < KEYPAD_SIZE; i++) {
+        if (emulator->keypad[i]) {
+            emulator->V[op->x] = i;
+            return true;
+        }
+    }
+    emulator->PC -= 2;
+    return true;
+}
+
+static inline bool chip8_op_ld_dt_vx(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("FX15: Setting the delay timer to VX");
+    emulator->delay_timer = emulator->V[op->x];
+    return true;
+}
+
+static inline bool chip8_op_ld_st_vx(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("FX18: Setting the sound timer to VX");
+    emulator->sound_timer = emulator->V[op->x];
+    return true;
+}
+
+static inline bool chip8_op_add_i_vx(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("FX1E: Adding VX to I");
+    emulator->I += emulator->V[op->x];
+    if (emulator->I + emulator->V[op->x] > 0x1000) {
+        emulator->V[0xF] = 1;
+    }
+    return true;
+}
+
+static inline bool chip8_op_ld_f_vx(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("FX29: Setting I to a character address");
+    emulator->I = emulator->V[op->x];
+    return true;
+}
+
+static inline bool chip8_op_ld_b_vx(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("FX33: Converting hex to decimal");
+    const uint8_t value = emulator->V[op->x];
+
+    emulator->memory[emulator->I & 0xFFF] = (value / 100) % 10;
+    emulator->memory[(emulator->I + 1) & 0xFFF] = (value / 10) % 10;
+    emulator->memory[(emulator->I + 2) & 0xFFF] = value % 10;
+    chip8_invalidate(emulator, emulator->I, 3);
+    return true;
+}
+
+static inline bool chip8_op_ld_i_vx(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("FX55: Storing variable registers in memory");
+    for (size_t i = 0; i <= op->x; i++) {
+        emulator->memory[(emulator->I + i) & 0xFFF] = emulator->V[i];
+    }
+    chip8_invalidate(emulator, emulator->I, op->x + 1);
+    emulator->I += op->x + 1;
+    return true;
+}
+
+static inline bool chip8_op_ld_vx_i(CHIP8 *emulator, const CHIP8_OP *op) {
+    log_async_trace("FX65: Storing memory in variable registers");
+    for (size_t i = 0; i <= op->x; i++) {
+        emulator->V[i] = emulator->memory[(emulator->I + i) & 0xFFF];
+    }
+    emulator->I += op->x + 1;
+    return true;
+}
+
+static inline bool chip8_op_invalid(CHIP8 *emulator, const CHIP8_OP *op) {
+    (void) emulator;
+    (void) op;
+    // This case doesn't exist!
+    log_async_warn("0x%03llX - Unknown instruction",
+                   (emulator->PC - 2) & 0xFFF);
+    return false;
+}
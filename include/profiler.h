@@ -0,0 +1,30 @@
+#pragma once
+
+#include "chip8.h"
+
+// Call tree nodes, one per distinct chain of subroutine calls
+#define PROFILE_NODES 4096
+// Distinct (call chain, address) pairs with their own count
+#define PROFILE_SITE_BITS 15
+#define PROFILE_SITES (1 << PROFILE_SITE_BITS)
+// Addresses listed in the hot spot report
+#define PROFILE_HOT 16
+
+typedef struct CHIP8_PROFILE CHIP8_PROFILE;
+
+CHIP8_PROFILE *chip8_profile_new(void);
+
+void chip8_profile_destroy(CHIP8_PROFILE *profile);
+
+void chip8_profile_reset(CHIP8_PROFILE *profile);
+
+bool chip8_execute_profiled(CHIP8 *emulator, uint32_t count);
+
+uint64_t chip8_profile_hits(const CHIP8_PROFILE *profile, uint16_t address);
+
+bool chip8_profile_write_folded(const CHIP8_PROFILE *profile, FILE *fp);
+
+bool chip8_profile_save_folded(const CHIP8_PROFILE *profile,
+                               const char *file_name);
+
+void chip8_profile_report(const CHIP8_PROFILE *profile, FILE *fp);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "chip8.h"
+#include "state.h"
+
+// Five minutes of frames in a few megabytes
+#define REWIND_FRAMES (FRAME_RATE * 60 * 5)
+#define REWIND_ARENA_SIZE (6 * 1024 * 1024)
+// Frames between full snapshots, bounding the work of one step back
+#define REWIND_KEYFRAME_INTERVAL 120
+
+typedef struct CHIP8_REWIND CHIP8_REWIND;
+
+CHIP8_REWIND *chip8_rewind_new(size_t frames, size_t arena_size);
+
+void chip8_rewind_destroy(CHIP8_REWIND *rewind);
+
+bool chip8_rewind_capture(CHIP8_REWIND *rewind, const CHIP8 *emulator);
+
+bool chip8_rewind_step(CHIP8_REWIND *rewind, CHIP8 *emulator);
+
+size_t chip8_rewind_count(const CHIP8_REWIND *rewind);
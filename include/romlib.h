@@ -0,0 +1,79 @@
+#pragma once
+
+#include "chip8.h"
+#include "state.h"
+
+#define ROMLIB_MAGIC "C8RL"
+#define ROMLIB_VERSION 1
+// Largest ROM that fits above the interpreter area
+#define ROMLIB_ROM_MAX (MEMORY_SIZE - 0x200)
+// Settings for the ROMs of a directory, one "hash ipf seed" line each
+#define ROMLIB_SETTINGS_FILE "romlib.txt"
+// Hashes of the ROMs of a directory, reused while a file's size and
+// modification time are unchanged. Hidden, so the scan skips it.
+#define ROMLIB_INDEX_FILE ".romlib-index"
+#define ROMLIB_INDEX_HEADER "# chipcraft ROM index 1\n"
+
+/*
+ * Archive layout, all fields little-endian:
+ *
+ *   0   magic "C8RL"       4    version, reserved    8    ROM count (u32)
+ *   12  reserved
+ *   16  entries sorted by hash, then name, each
+ *       0   content hash (u64)   8   offset (u32)    12  size (u32)
+ *       16  instructions per frame, reserved         20  seed (u32)
+ *       24  name, NUL-padded, cut to ROMLIB_NAME_SIZE - 1 bytes
+ *   ROM data at the offsets of the entries, shared by entries with the
+ *   same hash
+ */
+#define ROMLIB_HEADER_SIZE 16
+#define ROMLIB_ENTRY_SIZE 64
+#define ROMLIB_NAME_SIZE 40
+
+typedef struct {
+    // 0 keeps the configured value
+    uint16_t instructions_per_frame;
+    uint32_t seed;
+} CHIP8_ROM_SETTINGS;
+
+typedef struct CHIP8_ROM {
+    // FNV-1a hash of the contents
+    uint64_t hash;
+    // Points into the archive mapping, shared by every name with the same
+    // hash. NULL for a directory, whose ROMs are read when loaded.
+    const uint8_t *data;
+    uint32_t size;
+    CHIP8_ROM_SETTINGS settings;
+    // The full file name for a directory, the stored name for an archive
+    const char *name;
+    // The file of a directory ROM, which name points into; NULL in an
+    // archive
+    const char *path;
+} CHIP8_ROM;
+
+/*
+ * ROMs of a directory or an archive, indexed by content hash. Identical
+ * ROMs are stored once and every name is kept as an alias, so several
+ * entries in a row can share a hash.
+ */
+typedef struct {
+    // Sorted by hash, then name
+    CHIP8_ROM *roms;
+    size_t count;
+    // The mapped archive, or NULL for a directory
+    void *archive;
+    size_t archive_size;
+} CHIP8_ROMLIB;
+
+CHIP8_ROMLIB *chip8_romlib_open(const char *path);
+
+void chip8_romlib_close(CHIP8_ROMLIB *library);
+
+const CHIP8_ROM *chip8_romlib_find(const CHIP8_ROMLIB *library, uint64_t hash);
+
+const CHIP8_ROM *chip8_romlib_lookup(const CHIP8_ROMLIB *library,
+                                     const char *key);
+
+bool chip8_romlib_pack(const CHIP8_ROMLIB *library, const char *path);
+
+bool chip8_romlib_load(CHIP8 *emulator, const CHIP8_ROM *rom);
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "chip8.h"
+
+#define STATE_MAGIC "C8SS"
+#define STATE_VERSION 2
+
+/*
+ * Save state layout, all fields little-endian:
+ *
+ *   0   magic "C8SS"       4    version, reserved    8    V0 - VF
+ *   24  I, PC              28   stack depth, delay timer, sound timer, 0
+ *   32  stack (16 x u16)   64   instructions, frames (u64)
+ *   80  keypad bitmask, 0  84   random state (u32)   88   display (32 x u64)
+ *   344 memory
+ *
+ * Version 1 states have no random state and are still accepted.
+ */
+#define STATE_DISPLAY_OFFSET 88
+#define STATE_MEMORY_OFFSET (STATE_DISPLAY_OFFSET + DISPLAY_HEIGHT * 8)
+#define STATE_SIZE (STATE_MEMORY_OFFSET + MEMORY_SIZE)
+
+/*
+ * Little-endian field access, shared by the formats built on save states
+ */
+static inline void state_put16(uint8_t *p, uint16_t value) {
+    p[0] = value;
+    p[1] = value >> 8;
+}
+
+static inline void state_put32(uint8_t *p, uint32_t value) {
+    for (size_t i = 0; i < 4; i++) {
+        p[i] = value >> (i * 8);
+    }
+}
+
+static inline void state_put64(uint8_t *p, uint64_t value) {
+    for (size_t i = 0; i < 8; i++) {
+        p[i] = value >> (i * 8);
+    }
+}
+
+static inline uint16_t state_get16(const uint8_t *p) {
+    return p[0] | p[1] << 8;
+}
+
+static inline uint32_t state_get32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static inline uint64_t state_get64(const uint8_t *p) {
+    uint64_t value = 0;
+
+    for (size_t i = 0; i < 8; i++) {
+        value |= (uint64_t) p[i] << (i * 8);
+    }
+
+    return value;
+}
+
+bool chip8_state_save(const CHIP8 *emulator, uint8_t *buffer, size_t size);
+
+bool chip8_state_load(CHIP8 *emulator, const uint8_t *buffer, size_t size);
+
+bool chip8_state_save_file(const CHIP8 *emulator, const char *file_name);
+
+bool chip8_state_load_file(CHIP8 *emulator, const char *file_name);
+
+uint64_t chip8_hash_bytes(const uint8_t *data, size_t size);
+
+uint64_t chip8_state_hash(const CHIP8 *emulator);
+
+bool chip8_run_ahead(CHIP8 *emulator, uint32_t frames,
+                     uint64_t future[DISPLAY_HEIGHT]);
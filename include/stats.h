@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Optional instrumentation, enabled with the CHIP8_STATS build option.
+ * Without it every STATS_* macro expands to nothing.
+ */
+
+typedef enum {
+    PHASE_EXECUTE,
+    PHASE_DRAW,
+    PHASE_PRESENT,
+    PHASE_EVENTS,
+    PHASE_COUNT,
+} CHIP8_PHASE;
+
+#ifdef CHIP8_STATS
+
+// One in this many executions of an opcode form is timed
+#define STATS_SAMPLE_INTERVAL 64
+// Latency histogram buckets, bucket b holds durations below 2^b ns
+#define STATS_BUCKETS 32
+
+uint64_t chip8_stats_opcode_begin(uint8_t kind);
+
+void chip8_stats_opcode_end(uint8_t kind, uint64_t start);
+
+uint64_t chip8_stats_now(void);
+
+void chip8_stats_phase_end(CHIP8_PHASE phase, uint64_t start);
+
+uint64_t chip8_stats_count(uint8_t kind);
+
+void chip8_stats_reset(void);
+
+void chip8_stats_dump(FILE *fp);
+
+#define STATS_DECLARE(name) uint64_t name = 0
+#define STATS_OPCODE_BEGIN(name, kind) name = chip8_stats_opcode_begin(kind)
+#define STATS_OPCODE_END(name, kind) chip8_stats_opcode_end((kind), name)
+#define STATS_PHASE_BEGIN(name) name = chip8_stats_now()
+#define STATS_PHASE_END(name, phase) chip8_stats_phase_end((phase), name)
+#define STATS_DUMP(fp) chip8_stats_dump(fp)
+
+#else
+
+#define STATS_DECLARE(name)
+#define STATS_OPCODE_BEGIN(name, kind) ((void) 0)
+#define STATS_OPCODE_END(name, kind) ((void) 0)
+#define STATS_PHASE_BEGIN(name) ((void) 0)
+#define STATS_PHASE_END(name, phase) ((void) 0)
+#define STATS_DUMP(fp) ((void) 0)
+
+#endif
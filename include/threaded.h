@@ -0,0 +1,5 @@
+#pragma once
+
+#include "chip8.h"
+
+bool chip8_execute_threaded(CHIP8 *emulator, uint32_t count);
@@ -0,0 +1,382 @@
+#include "../include/aot.h"
+
+/*
+ * Ahead-of-time translation
+ *
+ * chip8_aot_translate() walks every block reachable from the ROM entry point
+ * and writes one C function per block. Each function runs the shared opcode
+ * bodies from opcodes.h with constant operands, so the C compiler can inline
+ * and optimize across a whole block. Computed jumps (BNNN) end a block and
+ * land wherever the interpreter takes them.
+ *
+ * At run time a block only runs if the memory it was translated from still
+ * holds the ROM bytes. Writes mark 64-byte lines dirty, and blocks on dirty
+ * lines are compared against the ROM before running, so self-modified code
+ * falls back to the interpreter.
+ */
+
+typedef struct {
+    const char *kind;
+    const char *body;
+} AOT_NAME;
+
+#define AOT_NAME_ENTRY(kind, body) [kind] = {#kind, #body}
+
+static const AOT_NAME aot_names[OP_COUNT] = {
+    AOT_NAME_ENTRY(OP_CLS, chip8_op_cls),
+    AOT_NAME_ENTRY(OP_RET, chip8_op_ret),
+    AOT_NAME_ENTRY(OP_SYS, chip8_op_sys),
+    AOT_NAME_ENTRY(OP_JP, chip8_op_jp),
+    AOT_NAME_ENTRY(OP_CALL, chip8_op_call),
+    AOT_NAME_ENTRY(OP_SE_BYTE, chip8_op_se_byte),
+    AOT_NAME_ENTRY(OP_SNE_BYTE, chip8_op_sne_byte),
+    AOT_NAME_ENTRY(OP_SE_REG, chip8_op_se_reg),
+    AOT_NAME_ENTRY(OP_LD_BYTE, chip8_op_ld_byte),
+    AOT_NAME_ENTRY(OP_ADD_BYTE, chip8_op_add_byte),
+    AOT_NAME_ENTRY(OP_LD_REG, chip8_op_ld_reg),
+    AOT_NAME_ENTRY(OP_OR, chip8_op_or),
+    AOT_NAME_ENTRY(OP_AND, chip8_op_and),
+    AOT_NAME_ENTRY(OP_XOR, chip8_op_xor),
+    AOT_NAME_ENTRY(OP_ADD_REG, chip8_op_add_reg),
+    AOT_NAME_ENTRY(OP_SUB, chip8_op_sub),
+    AOT_NAME_ENTRY(OP_SHR, chip8_op_shr),
+    AOT_NAME_ENTRY(OP_SUBN, chip8_op_subn),
+    AOT_NAME_ENTRY(OP_SHL, chip8_op_shl),
+    AOT_NAME_ENTRY(OP_SNE_REG, chip8_op_sne_reg),
+    AOT_NAME_ENTRY(OP_LD_I, chip8_op_ld_i),
+    AOT_NAME_ENTRY(OP_JP_V0, chip8_op_jp_v0),
+    AOT_NAME_ENTRY(OP_RND, chip8_op_rnd),
+    AOT_NAME_ENTRY(OP_DRW, chip8_op_drw),
+    AOT_NAME_ENTRY(OP_SKP, chip8_op_skp),
+    AOT_NAME_ENTRY(OP_SKNP, chip8_op_sknp),
+    AOT_NAME_ENTRY(OP_LD_VX_DT, chip8_op_ld_vx_dt),
+    AOT_NAME_ENTRY(OP_LD_VX_K, chip8_op_ld_vx_k),
+    AOT_NAME_ENTRY(OP_LD_DT_VX, chip8_op_ld_dt_vx),
+    AOT_NAME_ENTRY(OP_LD_ST_VX, chip8_op_ld_st_vx),
+    AOT_NAME_ENTRY(OP_ADD_I_VX, chip8_op_add_i_vx),
+    AOT_NAME_ENTRY(OP_LD_F_VX, chip8_op_ld_f_vx),
+    AOT_NAME_ENTRY(OP_LD_B_VX, chip8_op_ld_b_vx),
+    AOT_NAME_ENTRY(OP_LD_I_VX, chip8_op_ld_i_vx),
+    AOT_NAME_ENTRY(OP_LD_VX_I, chip8_op_ld_vx_i),
+    AOT_NAME_ENTRY(OP_INVALID, chip8_op_invalid),
+};
+
+/**
+ * @brief Checks whether an instruction lies entirely inside the ROM
+ * @param size: the size of the ROM in bytes
+ * @param address: the address of the instruction
+ * @returns a boolean that indicates whether it can be translated
+ */
+static bool chip8_aot_in_rom(size_t size, uint32_t address) {
+  return address >= AOT_ROM_ADDRESS && address + 1 < AOT_ROM_ADDRESS + size &&
+         address + 1 < MEMORY_SIZE;
+}
+
+/**
+ * @brief Decodes the instruction at an address of the ROM
+ * @param rom: the ROM image
+ * @param address: the address of the instruction
+ * @param op: a pointer to the decoded instruction
+ * @returns void
+ */
+static void chip8_aot_decode(const uint8_t* rom, uint16_t address,
+                             CHIP8_OP* op) {
+  const uint8_t* bytes = rom + (address - AOT_ROM_ADDRESS);
+
+  chip8_decode(bytes[0] << 8 | bytes[1], op);
+}
+
+/**
+ * @brief Finds where control can go after an instruction that ends a block
+ * @param op: the decoded instruction
+ * @param address: the address of the instruction
+ * @param successors: filled in with up to two static successors
+ * @param count: a pointer to the number of successors
+ * @returns a boolean that indicates whether the instruction ends a block
+ *
+ * Jumps, calls, returns and skips change PC. FX0A may repeat itself, and
+ * FX33 and FX55 write memory that the rest of the block might be made of.
+ */
+static bool chip8_aot_terminates(const CHIP8_OP* op, uint16_t address,
+                                 uint16_t successors[2], size_t* count) {
+  *count = 0;
+
+  switch (op->kind) {
+    case OP_JP:
+      successors[(*count)++] = op->nnn;
+      return true;
+    case OP_CALL:
+      successors[(*count)++] = op->nnn;
+      successors[(*count)++] = address + 2;
+      return true;
+    case OP_RET:
+    case OP_JP_V0:
+      return true;
+    case OP_SE_BYTE:
+    case OP_SNE_BYTE:
+    case OP_SE_REG:
+    case OP_SNE_REG:
+    case OP_SKP:
+    case OP_SKNP:
+      successors[(*count)++] = address + 2;
+      successors[(*count)++] = address + 4;
+      return true;
+    case OP_LD_VX_K:
+    case OP_LD_B_VX:
+    case OP_LD_I_VX:
+      successors[(*count)++] = address + 2;
+      return true;
+    default:
+      return false;
+  }
+}
+
+/**
+ * @brief Translates a ROM into C source
+ * @param rom: the ROM image, loaded at 0x200
+ * @param size: the size of the ROM in bytes
+ * @param source: the name of the ROM, for the header comment
+ * @param out: the stream to write the C source to
+ * @returns a boolean that indicates success
+ *
+ * The output defines chip8_aot_program, and a main that runs it headless
+ * when compiled with CHIP8_AOT_MAIN.
+ */
+bool chip8_aot_translate(const uint8_t* rom, size_t size, const char* source,
+                         FILE* out) {
+  uint8_t lengths[MEMORY_SIZE] = {0};
+  bool queued[MEMORY_SIZE] = {false};
+  uint16_t worklist[MEMORY_SIZE];
+  size_t pending = 0;
+  CHIP8_OP op;
+
+  if (size == 0 || size > MEMORY_SIZE - AOT_ROM_ADDRESS) {
+    return false;
+  }
+
+  worklist[pending++] = AOT_ROM_ADDRESS;
+  queued[AOT_ROM_ADDRESS] = true;
+
+  // Find every block reachable through static control flow
+  while (pending > 0) {
+    uint16_t start = worklist[--pending];
+    uint16_t address = start;
+    uint16_t successors[2];
+    size_t count = 0;
+    uint8_t length = 0;
+    bool terminated = false;
+
+    while (length < AOT_BLOCK_INSTRUCTIONS &&
+           chip8_aot_in_rom(size, address)) {
+      chip8_aot_decode(rom, address, &op);
+      if (op.kind == OP_INVALID) {
+        break;
+      }
+
+      length++;
+      if (chip8_aot_terminates(&op, address, successors, &count)) {
+        terminated = true;
+        break;
+      }
+      address += 2;
+    }
+
+    if (terminated == false && length == AOT_BLOCK_INSTRUCTIONS) {
+      successors[0] = address;
+      count = 1;
+    }
+
+    lengths[start] = length;
+
+    for (size_t i = 0; i < count; i++) {
+      uint16_t next = successors[i];
+      if (chip8_aot_in_rom(size, next) && queued[next] == false) {
+        queued[next] = true;
+        worklist[pending++] = next;
+      }
+    }
+  }
+
+  fprintf(out, "// Generated by chipcraft-aot from %s. Do not edit.\n\n",
+          source);
+  fprintf(out, "#include \"aot.h\"\n\n");
+
+  fprintf(out, "static const uint8_t chip8_aot_rom[%zu] = {", size);
+  for (size_t i = 0; i < size; i++) {
+    fprintf(out, "%s0x%02X,", i % 12 == 0 ? "\n    " : " ", rom[i]);
+  }
+  fprintf(out, "\n};\n");
+
+  for (uint16_t start = 0; start < MEMORY_SIZE; start++) {
+    if (lengths[start] == 0) {
+      continue;
+    }
+
+    fprintf(out,
+            "\nstatic bool chip8_aot_block_%03X(CHIP8 *emulator, "
+            "uint32_t *unexecuted) {\n",
+            start);
+    for (uint8_t i = 0; i < lengths[start]; i++) {
+      uint16_t address = start + i * 2;
+      chip8_aot_decode(rom, address, &op);
+      fprintf(out,
+              "    CHIP8_AOT_STEP(0x%03X, %u, %s, %s, 0x%03X, 0x%X, 0x%X, "
+              "0x%X, 0x%02X);\n",
+              address, lengths[start] - i - 1u, aot_names[op.kind].body,
+              aot_names[op.kind].kind, op.nnn, op.x, op.y, op.n, op.nn);
+    }
+    fprintf(out, "    return true;\n}\n");
+  }
+
+  fprintf(out, "\nstatic const CHIP8_AOT_ENTRY chip8_aot_blocks[%d] = {\n",
+          MEMORY_SIZE);
+  for (uint16_t start = 0; start < MEMORY_SIZE; start++) {
+    if (lengths[start] == 0) {
+      continue;
+    }
+
+    uint64_t lines = 0;
+    for (uint16_t line = start >> 6; line <= (start + lengths[start] * 2 - 1) >> 6;
+         line++) {
+      lines |= UINT64_C(1) << line;
+    }
+
+    fprintf(out, "    [0x%03X] = {chip8_aot_block_%03X, 0x%016llXULL, %u},\n",
+            start, start, (unsigned long long)lines, lengths[start]);
+  }
+  fprintf(out, "};\n\n");
+
+  fprintf(out,
+          "const CHIP8_AOT_PROGRAM chip8_aot_program = {\n"
+          "    .rom = chip8_aot_rom,\n"
+          "    .rom_size = sizeof(chip8_aot_rom),\n"
+          "    .blocks = chip8_aot_blocks,\n"
+          "};\n\n"
+          "#ifdef CHIP8_AOT_MAIN\n"
+          "int main(int argc, char *argv[]) {\n"
+          "    return chip8_aot_main(&chip8_aot_program, argc, argv);\n"
+          "}\n"
+          "#endif\n");
+
+  return ferror(out) == 0;
+}
+
+/**
+ * @brief Loads a translated ROM and selects the AOT backend
+ * @param emulator: a pointer to the CHIP-8 emulator
+ * @param program: a pointer to the translated program
+ * @returns a boolean indicating success
+ */
+bool chip8_aot_load(CHIP8* emulator, const CHIP8_AOT_PROGRAM* program) {
+  if (program->rom_size > MEMORY_SIZE - AOT_ROM_ADDRESS) {
+    return false;
+  }
+
+  memcpy(emulator->memory + AOT_ROM_ADDRESS, program->rom, program->rom_size);
+  chip8_invalidate(emulator, 0, MEMORY_SIZE);
+
+  // Memory holds exactly what was translated
+  emulator->dirty_lines = 0;
+  emulator->aot = program;
+  emulator->backend = BACKEND_AOT;
+
+  return true;
+}
+
+/**
+ * @brief Checks that memory still holds the code a block was translated from
+ * @param emulator: a pointer to the CHIP-8 emulator
+ * @param program: a pointer to the translated program
+ * @param address: the start address of the block
+ * @returns a boolean that indicates whether the block may run
+ */
+static bool chip8_aot_valid(const CHIP8* emulator,
+                            const CHIP8_AOT_PROGRAM* program,
+                            uint16_t address) {
+  const CHIP8_AOT_ENTRY* block = &program->blocks[address];
+
+  if ((emulator->dirty_lines & block->lines) == 0) {
+    return true;
+  }
+
+  return memcmp(emulator->memory + address,
+                program->rom + (address - AOT_ROM_ADDRESS),
+                block->length * 2) == 0;
+}
+
+/**
+ * @brief Executes instructions, running translated blocks where possible
+ * @param emulator: a pointer to the CHIP-8 emulator
+ * @param count: the number of instructions to execute
+ * @returns a boolean that indicates success
+ *
+ * Addresses without a valid block, and the tail of a budget too short for a
+ * whole block, run on the predecoded interpreter.
+ */
+bool chip8_execute_aot(CHIP8* emulator, uint32_t count) {
+  const CHIP8_AOT_PROGRAM* program = emulator->aot;
+  uint32_t remaining = count;
+
+  if (program == NULL) {
+    return chip8_execute_cached(emulator, count);
+  }
+
+  while (remaining > 0) {
+    uint16_t pc = emulator->PC;
+
+    if (pc < MEMORY_SIZE && program->blocks[pc].run != NULL &&
+        program->blocks[pc].length <= remaining &&
+        chip8_aot_valid(emulator, program, pc)) {
+      uint32_t unexecuted = 0;
+      bool success = program->blocks[pc].run(emulator, &unexecuted);
+      uint32_t executed = program->blocks[pc].length - unexecuted;
+
+      remaining -= executed;
+      emulator->instructions += executed;
+      if (success == false) {
+        return false;
+      }
+      continue;
+    }
+
+    remaining--;
+    if (chip8_execute_cached(emulator, 1) == false) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @brief Runs a translated ROM headless, for generated executables
+ * @param program: a pointer to the translated program
+ * @param argc: the argument count, an optional frame count may follow
+ * @param argv: the arguments
+ * @returns the process exit code
+ */
+int chip8_aot_main(const CHIP8_AOT_PROGRAM* program, int argc, char* argv[]) {
+  uint64_t frames = argc > 1 ? strtoull(argv[1], NULL, 0) : HEADLESS_FRAMES;
+  CHIP8* emulator = chip8_new();
+
+  if (emulator == NULL) {
+    perror("Emulator could not be allocated!");
+    return EXIT_FAILURE;
+  }
+
+  if (chip8_aot_load(emulator, program) == false) {
+    perror("ROM was not loaded successfully!");
+    chip8_destroy(emulator);
+    return EXIT_FAILURE;
+  }
+
+  bool success = chip8_run_headless(emulator, frames, UINT64_MAX);
+
+  printf("Executed %llu instructions in %llu frames, PC at 0x%04X\n",
+         (unsigned long long)emulator->instructions,
+         (unsigned long long)emulator->frames, emulator->PC);
+
+  chip8_destroy(emulator);
+
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,61 @@
+#include "../include/aot.h"
+
+static void usage(char *program) {
+    printf("Usage: %s [-o <output>] <file_name>\n", program);
+}
+
+int main(int argc, char *argv[]) {
+    uint8_t rom[MEMORY_SIZE - AOT_ROM_ADDRESS];
+    char *output = NULL;
+    char *file_name = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (file_name == NULL && argv[i][0] != '-') {
+            file_name = argv[i];
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (file_name == NULL) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    FILE *fp = fopen(file_name, "rb");
+    if (fp == NULL) {
+        perror("ROM could not be opened!");
+        return EXIT_FAILURE;
+    }
+
+    size_t size = fread(rom, 1, sizeof(rom), fp);
+    bool truncated = fgetc(fp) != EOF;
+    fclose(fp);
+
+    if (size == 0 || truncated) {
+        fprintf(stderr, "ROM must be between 1 and %zu bytes\n", sizeof(rom));
+        return EXIT_FAILURE;
+    }
+
+    FILE *out = output != NULL ? fopen(output, "w") : stdout;
+    if (out == NULL) {
+        perror("Output could not be opened!");
+        return EXIT_FAILURE;
+    }
+
+    bool success = chip8_aot_translate(rom, size, file_name, out);
+
+    if (out != stdout && fclose(out) != 0) {
+        success = false;
+    }
+
+    if (success == false) {
+        fprintf(stderr, "Translation failed\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+#include <string.h>
+#include "../include/audio.h"
+
+/*
+ * Beeper
+ *
+ * SDL pulls samples from its own thread through audio_callback(). The
+ * callback never allocates or takes a lock: it reads one atomic flag and
+ * writes a square wave, or silence, from a phase counter only it touches.
+ * The phase carries over between buffers and while silent, so every beep
+ * starts on a clean edge of the wave.
+ */
+
+/**
+ * @brief Writes the next samples of the beep
+ * @param audio: a pointer to the beeper
+ * @param samples: where the mono 16-bit samples go
+ * @param count: the number of samples
+ * @returns void
+ */
+void audio_fill(CHIP8_AUDIO* audio, int16_t* samples, size_t count) {
+  bool playing =
+      atomic_load_explicit(&audio->playing, memory_order_relaxed);
+
+  if (playing == false) {
+    memset(samples, 0, count * sizeof(int16_t));
+    return;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    samples[i] = audio->phase < UINT32_C(0x80000000) ? AUDIO_AMPLITUDE
+                                                     : -AUDIO_AMPLITUDE;
+    audio->phase += audio->step;
+  }
+}
+
+static void audio_callback(void* data, Uint8* stream, int length) {
+  audio_fill(data, (int16_t*)stream, length / sizeof(int16_t));
+}
+
+/**
+ * @brief Opens the default audio device and starts it, silent
+ * @param audio: a pointer to the beeper
+ * @param samples: the buffer size in samples, a power of two
+ * @returns a boolean that indicates success
+ *
+ * The device may run at another rate than asked for, so the wave is
+ * stepped for the rate it actually has.
+ */
+bool audio_open(CHIP8_AUDIO* audio, uint16_t samples) {
+  SDL_AudioSpec want;
+  SDL_AudioSpec have;
+
+  audio->device = 0;
+  audio->phase = 0;
+  atomic_init(&audio->playing, false);
+
+  if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) {
+    return false;
+  }
+
+  memset(&want, 0, sizeof(want));
+  want.freq = AUDIO_FREQUENCY;
+  want.format = AUDIO_S16SYS;
+  want.channels = 1;
+  want.samples = samples;
+  want.callback = audio_callback;
+  want.userdata = audio;
+
+  audio->device = SDL_OpenAudioDevice(NULL, 0, &want, &have,
+                                      SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+  if (audio->device == 0) {
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    return false;
+  }
+
+  audio->step = (uint32_t)((UINT64_C(1) << 32) * AUDIO_TONE / have.freq);
+  SDL_PauseAudioDevice(audio->device, 0);
+
+  return true;
+}
+
+/**
+ * @brief Stops and closes the audio device
+ * @param audio: a pointer to the beeper
+ * @returns void
+ */
+void audio_close(CHIP8_AUDIO* audio) {
+  if (audio->device == 0) {
+    return;
+  }
+
+  SDL_CloseAudioDevice(audio->device);
+  SDL_QuitSubSystem(SDL_INIT_AUDIO);
+  audio->device = 0;
+}
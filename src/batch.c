@@ -0,0 +1,202 @@
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/batch.h"
+
+/*
+ * Batch runner
+ *
+ * Worker threads take the next job from a shared counter, so a slow ROM
+ * never holds up the others. Each worker owns one emulator and resets it
+ * between ROMs. Results are printed in the order the jobs were given: when
+ * a worker finishes a job it prints every finished job from the first
+ * unprinted one on, under a lock that is only taken once per ROM.
+ */
+
+typedef struct {
+    CHIP8_BATCH_JOB *jobs;
+    size_t count;
+    const CHIP8_BATCH_CONFIG *config;
+    FILE *out;
+    atomic_size_t next;
+    atomic_size_t failed;
+    pthread_mutex_t lock;
+    // First job not printed yet, guarded by lock
+    size_t printed;
+} CHIP8_BATCH;
+
+static double chip8_batch_now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Hashes what is on the display
+ * @param emulator: a pointer to the CHIP-8 emulator
+ * @returns the 64-bit FNV-1a hash, the same on every host
+ */
+uint64_t chip8_display_hash(const CHIP8* emulator) {
+  uint8_t rows[DISPLAY_HEIGHT * 8];
+
+  for (size_t y = 0; y < DISPLAY_HEIGHT; y++) {
+    state_put64(rows + y * 8, emulator->display[y]);
+  }
+
+  return chip8_hash_bytes(rows, sizeof(rows));
+}
+
+/**
+ * @brief Writes the result line of a job
+ * @param out: the stream to write to
+ * @param job: a pointer to the job that has run
+ * @returns void
+ */
+void chip8_batch_print(FILE* out, const CHIP8_BATCH_JOB* job) {
+  if (job->loaded == false) {
+    fprintf(out, "%s error=load\n", job->name);
+    return;
+  }
+
+  fprintf(out, "%s display=%016llX instructions=%llu frames=%llu ",
+          job->name, (unsigned long long)job->display_hash,
+          (unsigned long long)job->instructions,
+          (unsigned long long)job->frames);
+
+  if (job->failed == true) {
+    fprintf(out, "error=%04X@%03X", job->error_opcode, job->error_address);
+  } else {
+    fprintf(out, "error=none");
+  }
+
+  fprintf(out, " time=%.3fms\n", job->seconds * 1000);
+}
+
+/**
+ * @brief Runs one job on a worker's emulator
+ * @param emulator: a pointer to the worker's CHIP-8 emulator
+ * @param config: a pointer to the batch configuration
+ * @param job: a pointer to the job
+ * @returns void
+ */
+static void chip8_batch_job(CHIP8* emulator, const CHIP8_BATCH_CONFIG* config,
+                            CHIP8_BATCH_JOB* job) {
+  double start = chip8_batch_now();
+
+  job->failed = false;
+
+  // ROM settings only last for their own ROM
+  emulator->instructions_per_frame = config->instructions_per_frame;
+  emulator->backend = config->backend;
+  emulator->busy_wait = config->busy_wait;
+  chip8_seed(emulator, config->seed);
+  chip8_reset(emulator);
+
+  job->loaded = job->rom != NULL ? chip8_romlib_load(emulator, job->rom)
+                                 : chip8_load_rom(emulator, (char*)job->name);
+  if (job->loaded == true &&
+      chip8_run_headless(emulator, config->frames, config->cycles) == false) {
+    // Reported the same way as a headless run of chipcraft
+    uint16_t pc = (emulator->PC - 2) & (MEMORY_SIZE - 1);
+    job->failed = true;
+    job->error_address = pc;
+    job->error_opcode = emulator->memory[pc] << 8 |
+                        emulator->memory[(pc + 1) & (MEMORY_SIZE - 1)];
+  }
+
+  job->instructions = emulator->instructions;
+  job->frames = emulator->frames;
+  job->display_hash = chip8_display_hash(emulator);
+  job->seconds = chip8_batch_now() - start;
+}
+
+static void* chip8_batch_worker(void* data) {
+  CHIP8_BATCH* batch = data;
+  CHIP8* emulator = chip8_new();
+
+  for (size_t i = atomic_fetch_add(&batch->next, 1); i < batch->count;
+       i = atomic_fetch_add(&batch->next, 1)) {
+    CHIP8_BATCH_JOB* job = &batch->jobs[i];
+
+    if (emulator != NULL) {
+      chip8_batch_job(emulator, batch->config, job);
+    }
+    if (job->loaded == false || job->failed == true) {
+      atomic_fetch_add(&batch->failed, 1);
+    }
+    atomic_store(&job->done, true);
+
+    pthread_mutex_lock(&batch->lock);
+    while (batch->printed < batch->count &&
+           atomic_load(&batch->jobs[batch->printed].done) == true) {
+      if (batch->out != NULL) {
+        chip8_batch_print(batch->out, &batch->jobs[batch->printed]);
+      }
+      batch->printed++;
+    }
+    pthread_mutex_unlock(&batch->lock);
+  }
+
+  chip8_destroy(emulator);
+
+  return NULL;
+}
+
+/**
+ * @brief Runs every job headlessly on a pool of threads
+ * @param jobs: the jobs, with name and rom set
+ * @param count: the number of jobs
+ * @param config: a pointer to the batch configuration
+ * @param out: the stream result lines are written to in job order, or
+ * NULL
+ * @returns the number of jobs that failed to load or hit a failing
+ * instruction
+ *
+ * The calling thread counts as one of the workers.
+ */
+size_t chip8_batch_run(CHIP8_BATCH_JOB* jobs, size_t count,
+                       const CHIP8_BATCH_CONFIG* config, FILE* out) {
+  CHIP8_BATCH batch = {
+      .jobs = jobs,
+      .count = count,
+      .config = config,
+      .out = out,
+  };
+  unsigned threads = config->threads;
+
+  if (threads == 0) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = online > 0 ? online : 1;
+  }
+  if (threads > count) {
+    threads = count > 0 ? count : 1;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    atomic_init(&jobs[i].done, false);
+  }
+  atomic_init(&batch.next, 0);
+  atomic_init(&batch.failed, 0);
+  pthread_mutex_init(&batch.lock, NULL);
+
+  pthread_t* workers = calloc(threads, sizeof(pthread_t));
+  unsigned started = 0;
+  while (workers != NULL && started + 1 < threads &&
+         pthread_create(&workers[started], NULL, chip8_batch_worker,
+                        &batch) == 0) {
+    started++;
+  }
+
+  chip8_batch_worker(&batch);
+
+  for (unsigned i = 0; i < started; i++) {
+    pthread_join(workers[i], NULL);
+  }
+
+  free(workers);
+  pthread_mutex_destroy(&batch.lock);
+
+  return atomic_load(&batch.failed);
+}
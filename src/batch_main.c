@@ -0,0 +1,245 @@
+#include <limits.h>
+#include <time.h>
+#include "../include/batch.h"
+
+#define BATCH_MAX_LIBRARIES 64
+#define BATCH_INITIAL_JOBS 256
+
+typedef struct {
+    CHIP8_BATCH_JOB *jobs;
+    size_t count;
+    size_t capacity;
+    CHIP8_ROMLIB *libraries[BATCH_MAX_LIBRARIES];
+    size_t library_count;
+    // Paths read from --from lists, freed with the input
+    char **paths;
+    size_t path_count;
+    size_t path_capacity;
+} BATCH_INPUT;
+
+static void usage(char *program) {
+    printf("Usage: %s [--threads <count>] [--frames <count>] "
+           "[--cycles <count>] [--ipf <count>] "
+           "[--backend cached|switch|threaded|jit] [--seed <number>] "
+           "[--busy-wait] [--from <list>] <rom|directory|archive>...\n",
+           program);
+}
+
+/**
+ * @brief Appends a job
+ * @param input: a pointer to the jobs collected so far
+ * @param name: the name of the ROM, which must outlive the batch
+ * @param rom: the ROM in a library, or NULL to read the file
+ * @returns a boolean that indicates success
+ */
+static bool add_job(BATCH_INPUT *input, const char *name,
+                    const CHIP8_ROM *rom) {
+    if (input->count == input->capacity) {
+        size_t capacity =
+            input->capacity > 0 ? input->capacity * 2 : BATCH_INITIAL_JOBS;
+        CHIP8_BATCH_JOB *jobs =
+            realloc(input->jobs, capacity * sizeof(CHIP8_BATCH_JOB));
+        if (jobs == NULL) {
+            return false;
+        }
+
+        input->jobs = jobs;
+        input->capacity = capacity;
+    }
+
+    CHIP8_BATCH_JOB *job = &input->jobs[input->count++];
+    memset(job, 0, sizeof(CHIP8_BATCH_JOB));
+    job->name = name;
+    job->rom = rom;
+
+    return true;
+}
+
+/**
+ * @brief Checks whether a file starts like a ROM archive
+ * @param path: the path of a regular file
+ * @returns a boolean that indicates whether it has the archive magic
+ */
+static bool is_archive(const char *path) {
+    char magic[4];
+
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return false;
+    }
+
+    bool match = fread(magic, 1, sizeof(magic), fp) == sizeof(magic) &&
+                 memcmp(magic, ROMLIB_MAGIC, sizeof(magic)) == 0;
+    fclose(fp);
+
+    return match;
+}
+
+/**
+ * @brief Adds a ROM file, or every ROM of a directory or archive
+ * @param input: a pointer to the jobs collected so far
+ * @param path: the path given, which must outlive the batch
+ * @returns a boolean that indicates success
+ */
+static bool add_path(BATCH_INPUT *input, const char *path) {
+    struct stat st;
+
+    if (stat(path, &st) != 0) {
+        // Reported as a ROM that failed to load
+        return add_job(input, path, NULL);
+    }
+
+    // Anything that is not a directory or an archive is a single ROM
+    if (S_ISDIR(st.st_mode) == false && is_archive(path) == false) {
+        return add_job(input, path, NULL);
+    }
+
+    CHIP8_ROMLIB *library = chip8_romlib_open(path);
+    if (library == NULL) {
+        fprintf(stderr, "ROM library %s could not be opened\n", path);
+        return false;
+    }
+
+    if (input->library_count == BATCH_MAX_LIBRARIES) {
+        fprintf(stderr, "More than %d libraries\n", BATCH_MAX_LIBRARIES);
+        chip8_romlib_close(library);
+        return false;
+    }
+    input->libraries[input->library_count++] = library;
+
+    // Aliases of identical ROMs run once, under the first name
+    for (size_t i = 0; i < library->count; i++) {
+        const CHIP8_ROM *rom = &library->roms[i];
+        if (i > 0 && rom[-1].hash == rom->hash) {
+            continue;
+        }
+        if (add_job(input, rom->name, rom) == false) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Adds every path listed in a file, one per line
+ * @param input: a pointer to the jobs collected so far
+ * @param list: the name of the file
+ * @returns a boolean that indicates success
+ */
+static bool add_list(BATCH_INPUT *input, const char *list) {
+    char line[PATH_MAX];
+    bool success = true;
+
+    FILE *fp = fopen(list, "r");
+    if (fp == NULL) {
+        perror("List could not be opened!");
+        return false;
+    }
+
+    while (success && fgets(line, sizeof(line), fp) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+
+        if (input->path_count == input->path_capacity) {
+            size_t capacity = input->path_capacity > 0
+                                  ? input->path_capacity * 2
+                                  : BATCH_INITIAL_JOBS;
+            char **paths = realloc(input->paths, capacity * sizeof(char *));
+            if (paths == NULL) {
+                success = false;
+                break;
+            }
+            input->paths = paths;
+            input->path_capacity = capacity;
+        }
+
+        char *path = strdup(line);
+        if (path == NULL) {
+            success = false;
+            break;
+        }
+        input->paths[input->path_count++] = path;
+        success = add_path(input, path);
+    }
+
+    fclose(fp);
+
+    return success;
+}
+
+/**
+ * @brief Frees the jobs and everything they point into
+ * @param input: a pointer to the jobs collected so far
+ * @returns void
+ */
+static void free_input(BATCH_INPUT *input) {
+    for (size_t i = 0; i < input->library_count; i++) {
+        chip8_romlib_close(input->libraries[i]);
+    }
+
+    for (size_t i = 0; i < input->path_count; i++) {
+        free(input->paths[i]);
+    }
+
+    free(input->paths);
+    free(input->jobs);
+}
+
+int main(int argc, char *argv[]) {
+    CHIP8_BATCH_CONFIG config = {
+        .frames = HEADLESS_FRAMES,
+        .cycles = UINT64_MAX,
+        .instructions_per_frame = INSTRUCTIONS_PER_FRAME,
+        .backend = BACKEND_CACHED,
+    };
+    BATCH_INPUT input = {0};
+    bool success = true;
+
+    for (int i = 1; i < argc && success; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            config.threads = strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            config.frames = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+            config.cycles = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--ipf") == 0 && i + 1 < argc) {
+            config.instructions_per_frame = strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+            success = chip8_parse_backend(argv[++i], &config.backend);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            config.seed = strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--busy-wait") == 0) {
+            config.busy_wait = true;
+        } else if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+            success = add_list(&input, argv[++i]);
+        } else if (argv[i][0] != '-') {
+            success = add_path(&input, argv[i]);
+        } else {
+            success = false;
+        }
+    }
+
+    if (success == false || input.count == 0 ||
+        config.instructions_per_frame == 0) {
+        usage(argv[0]);
+        free_input(&input);
+        return EXIT_FAILURE;
+    }
+
+    struct timespec start;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t failed = chip8_batch_run(input.jobs, input.count, &config, stdout);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    fprintf(stderr, "Ran %zu ROMs in %.3f s, %zu failed\n", input.count,
+            (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9,
+            failed);
+
+    free_input(&input);
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,93 @@
+#include "../include/frame.h"
+
+// Eight texture pixels for every possible byte of a display row, built at
+// compile time
+#define LUT_PIXEL(b, i) ((((b) >> (7 - (i))) & 1) ? UINT32_MAX : 0)
+#define LUT_ROW(b)                                                    \
+  {LUT_PIXEL(b, 0), LUT_PIXEL(b, 1), LUT_PIXEL(b, 2), LUT_PIXEL(b, 3), \
+   LUT_PIXEL(b, 4), LUT_PIXEL(b, 5), LUT_PIXEL(b, 6), LUT_PIXEL(b, 7)}
+#define LUT_4(b) LUT_ROW(b), LUT_ROW(b + 1), LUT_ROW(b + 2), LUT_ROW(b + 3)
+#define LUT_16(b) LUT_4(b), LUT_4(b + 4), LUT_4(b + 8), LUT_4(b + 12)
+#define LUT_64(b) LUT_16(b), LUT_16(b + 16), LUT_16(b + 32), LUT_16(b + 48)
+
+static const uint32_t pixel_lut[256][8] = {LUT_64(0), LUT_64(64), LUT_64(128),
+                                           LUT_64(192)};
+
+/**
+ * @brief Empties a triple buffer
+ * @param buffer: a pointer to the triple buffer
+ * @returns void
+ */
+void frame_buffer_init(CHIP8_FRAME_BUFFER* buffer) {
+  memset(buffer->buffers, 0, sizeof(buffer->buffers));
+  buffer->back = 0;
+  atomic_init(&buffer->middle, 1);
+  buffer->front = 2;
+}
+
+/**
+ * @brief Gets the buffer the producer writes the next frame into
+ * @param buffer: a pointer to the triple buffer
+ * @returns a pointer to the frame, owned by the producer until published
+ */
+CHIP8_FRAME* frame_buffer_back(CHIP8_FRAME_BUFFER* buffer) {
+  return &buffer->buffers[buffer->back];
+}
+
+/**
+ * @brief Hands the frame written into the back buffer to the consumer
+ * @param buffer: a pointer to the triple buffer
+ * @returns void
+ *
+ * A frame the consumer has not taken yet is replaced, so it only ever sees
+ * the newest one.
+ */
+void frame_buffer_publish(CHIP8_FRAME_BUFFER* buffer) {
+  uint_fast8_t previous = atomic_exchange_explicit(
+      &buffer->middle, buffer->back | FRAME_FRESH, memory_order_acq_rel);
+
+  buffer->back = previous & ~FRAME_FRESH;
+}
+
+/**
+ * @brief Takes the newest published frame, if there is one
+ * @param buffer: a pointer to the triple buffer
+ * @param frame: set to the consumer's current frame
+ * @returns a boolean that indicates whether the frame is new since the last
+ * call
+ */
+bool frame_buffer_acquire(CHIP8_FRAME_BUFFER* buffer,
+                          const CHIP8_FRAME** frame) {
+  bool fresh = (atomic_load_explicit(&buffer->middle, memory_order_relaxed) &
+                FRAME_FRESH) != 0;
+
+  if (fresh == true) {
+    uint_fast8_t previous = atomic_exchange_explicit(
+        &buffer->middle, buffer->front, memory_order_acq_rel);
+    buffer->front = previous & ~FRAME_FRESH;
+  }
+
+  *frame = &buffer->buffers[buffer->front];
+
+  return fresh;
+}
+
+/**
+ * @brief Expands display rows into 32-bit pixels
+ * @param pixels: where the first row goes
+ * @param pitch: the number of bytes between rows of pixels
+ * @param display: the display, one word per row with column 0 in the top bit
+ * @param first: the first row to expand
+ * @param last: the last row to expand
+ * @returns void
+ */
+void expand_rows(void* pixels, int pitch, const uint64_t* display, int first,
+                 int last) {
+  for (int y = first; y <= last; y++) {
+    uint32_t* line = (uint32_t*)((uint8_t*)pixels + (y - first) * pitch);
+    for (int byte = 0; byte < DISPLAY_WIDTH / 8; byte++) {
+      uint8_t bits = display[y] >> (56 - byte * 8);
+      memcpy(line + byte * 8, pixel_lut[bits], sizeof(pixel_lut[bits]));
+    }
+  }
+}
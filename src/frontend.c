@@ -0,0 +1,479 @@
+#include "../include/frontend.h"
+#include "../include/audio.h"
+#include "../include/frame.h"
+#include "../include/hud.h"
+#include "../include/movie.h"
+#include "../include/profiler.h"
+#include "../include/rewind.h"
+#include "../include/romlib.h"
+#include "../include/state.h"
+
+/*
+ * SDL front end
+ *
+ * Everything that needs SDL lives here and in graphics.c, hud.c and
+ * audio.c, so the emulator core, the headless runners and their tests
+ * build without it.
+ */
+
+/*
+ * State shared between the SDL thread and the emulation thread
+ */
+typedef struct {
+  CHIP8* emulator;
+  CHIP8_FRAME_BUFFER frames;
+  // Recent frames to step back through, NULL if unavailable
+  CHIP8_REWIND* rewind;
+  // Input being recorded, or NULL
+  CHIP8_MOVIE* movie;
+  // Beeper following the sound timer, or NULL without audio
+  CHIP8_AUDIO* audio;
+  // One bit per CHIP-8 key, written by the SDL thread
+  atomic_uint_fast16_t keys;
+  // Frames shown ahead of the present to hide input lag
+  uint8_t run_ahead;
+  // Set while the rewind key is held
+  atomic_bool rewinding;
+  // Emulated frames per 60 Hz frame, or SPEED_UNCAPPED
+  atomic_uint_fast8_t speed;
+  // Set while the turbo key is held, which runs uncapped
+  atomic_bool turbo;
+  atomic_bool quit;
+  // Totals for the HUD, stored once per frame by the emulation thread
+  atomic_uint_fast64_t instructions;
+  atomic_uint_fast64_t frames_run;
+  atomic_uint_fast64_t dropped;
+  atomic_uint_fast64_t execute_ticks;
+} CHIP8_SESSION;
+
+/*
+ * The CHIP-8 keypad laid out on the left of a QWERTY keyboard:
+ *
+ *   1 2 3 C      1 2 3 4
+ *   4 5 6 D  ->  Q W E R
+ *   7 8 9 E      A S D F
+ *   A 0 B F      Z X C V
+ */
+static const struct {
+  SDL_Keycode key;
+  uint8_t index;
+} chip8_keymap[KEYPAD_SIZE] = {
+    {SDLK_1, 0x1}, {SDLK_2, 0x2}, {SDLK_3, 0x3}, {SDLK_4, 0xC},
+    {SDLK_q, 0x4}, {SDLK_w, 0x5}, {SDLK_e, 0x6}, {SDLK_r, 0xD},
+    {SDLK_a, 0x7}, {SDLK_s, 0x8}, {SDLK_d, 0x9}, {SDLK_f, 0xE},
+    {SDLK_z, 0xA}, {SDLK_x, 0x0}, {SDLK_c, 0xB}, {SDLK_v, 0xF},
+};
+
+/**
+ * @brief Maps a keyboard key to the CHIP-8 key it stands for
+ * @param key: the SDL keycode
+ * @returns the CHIP-8 key, or -1 if the key is not mapped
+ */
+static int chip8_key_index(SDL_Keycode key) {
+  for (size_t i = 0; i < KEYPAD_SIZE; i++) {
+    if (chip8_keymap[i].key == key) {
+      return chip8_keymap[i].index;
+    }
+  }
+
+  return -1;
+}
+
+/**
+ * @brief Runs one emulated frame of a session, or steps one back
+ * @param session: a pointer to the session
+ * @param keys: the keypad bitmask the frame runs with
+ * @param rewinding: whether to step back instead
+ * @returns void
+ */
+static void chip8_session_step(CHIP8_SESSION* session, uint_fast16_t keys,
+                               bool rewinding) {
+  CHIP8* emulator = session->emulator;
+
+  if (rewinding == true) {
+    chip8_rewind_step(session->rewind, emulator);
+    return;
+  }
+
+  if (session->movie != NULL &&
+      chip8_movie_record(session->movie, emulator->frames, keys) == false) {
+    log_async_error("Movie input could not be recorded");
+  }
+
+  bool success = chip8_run_frame(emulator);
+  if (success == false) {
+    log_async_error("Instruction failed at 0x%03llX",
+                    (emulator->PC - 2) & 0xFFF);
+  }
+
+  if (session->rewind != NULL) {
+    chip8_rewind_capture(session->rewind, emulator);
+  }
+}
+
+/**
+ * @brief Runs frames at 60 Hz and publishes every changed display
+ * @param data: a pointer to the CHIP8_SESSION
+ * @returns 0 once the session quits
+ *
+ * This thread owns the emulator. It never waits on the renderer: finished
+ * frames go into the triple buffer and older unpresented ones are dropped.
+ */
+static int chip8_emulate(void* data) {
+  CHIP8_SESSION* session = data;
+  CHIP8* emulator = session->emulator;
+  const uint64_t frequency = SDL_GetPerformanceFrequency();
+  const uint64_t frame_ticks = frequency / FRAME_RATE;
+  uint64_t deadline = SDL_GetPerformanceCounter() + frame_ticks;
+
+  while (atomic_load(&session->quit) == false) {
+    uint_fast16_t keys =
+        atomic_load_explicit(&session->keys, memory_order_relaxed);
+    bool rewinding = atomic_load(&session->rewinding) == true &&
+                     session->rewind != NULL;
+
+    for (size_t i = 0; i < KEYPAD_SIZE; i++) {
+      emulator->keypad[i] = (keys >> i) & 1;
+    }
+
+    // Fast-forwarding runs several frames and only shows the last one.
+    // Uncapped runs frames until the next deadline, rewinding is never
+    // sped up.
+    uint_fast8_t speed =
+        atomic_load_explicit(&session->speed, memory_order_relaxed);
+    if (atomic_load_explicit(&session->turbo, memory_order_relaxed) == true) {
+      speed = SPEED_UNCAPPED;
+    }
+    if (rewinding == true) {
+      speed = 1;
+    }
+
+    uint64_t begin = SDL_GetPerformanceCounter();
+    for (uint32_t run = 1;; run++) {
+      chip8_session_step(session, keys, rewinding);
+
+      if (speed != SPEED_UNCAPPED ? run >= speed
+                                  : SDL_GetPerformanceCounter() >= deadline) {
+        break;
+      }
+    }
+
+    atomic_fetch_add_explicit(&session->execute_ticks,
+                              SDL_GetPerformanceCounter() - begin,
+                              memory_order_relaxed);
+    atomic_store_explicit(&session->instructions, emulator->instructions,
+                          memory_order_relaxed);
+    atomic_store_explicit(&session->frames_run, emulator->frames,
+                          memory_order_relaxed);
+
+    if (session->audio != NULL) {
+      audio_set(session->audio, emulator->sound_timer > 0);
+    }
+
+    if (session->run_ahead > 0 && rewinding == false) {
+      // Show where the current input leads instead of the present frame
+      CHIP8_FRAME* frame = frame_buffer_back(&session->frames);
+      chip8_run_ahead(emulator, session->run_ahead, frame->rows);
+      frame->sequence = emulator->frames;
+      frame_buffer_publish(&session->frames);
+    } else if (emulator->dirty_rows != 0) {
+      CHIP8_FRAME* frame = frame_buffer_back(&session->frames);
+      memcpy(frame->rows, emulator->display, sizeof(frame->rows));
+      frame->sequence = emulator->frames;
+      frame_buffer_publish(&session->frames);
+      emulator->dirty_rows = 0;
+    }
+
+    // Sleep until the next 60 Hz deadline. A frame that overran never
+    // produces a negative delay, and falling too far behind resynchronizes
+    // instead of bursting to catch up. Uncapped frames use up all the time
+    // there is, so they are never counted as dropped.
+    uint64_t now = SDL_GetPerformanceCounter();
+    if (speed == SPEED_UNCAPPED) {
+      deadline = now + frame_ticks;
+    } else if (now < deadline) {
+      SDL_Delay((uint32_t)((deadline - now) * 1000 / frequency));
+      deadline += frame_ticks;
+    } else if (now - deadline > frame_ticks * FRAME_RATE / 4) {
+      deadline = now + frame_ticks;
+      atomic_fetch_add_explicit(&session->dropped, 1, memory_order_relaxed);
+    } else {
+      deadline += frame_ticks;
+      atomic_fetch_add_explicit(&session->dropped, 1, memory_order_relaxed);
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * @brief The main entrypoint for the emulator
+ * @param file_name: the name of the ROM file
+ * @param config: a pointer to the run configuration
+ * @returns void
+ *
+ * Emulation runs on its own thread. This thread handles SDL events and
+ * presents the newest complete frame, so vsync never stalls the emulator.
+ */
+void chip8_run(char* file_name, const CHIP8_CONFIG* config) {
+  SDL_Texture* screen = NULL;
+  SDL_Renderer* renderer = NULL;
+  SDL_Window* window = NULL;
+  SDL_Event event;
+  bool quit = false;
+  CHIP8_SESSION session;
+  CHIP8* emulator = chip8_new();
+
+  if (emulator == NULL) {
+    perror("Emulator could not be allocated!");
+    return;
+  }
+
+  emulator->instructions_per_frame = config->instructions_per_frame;
+  emulator->backend = config->backend;
+  emulator->busy_wait = config->busy_wait;
+  chip8_seed(emulator, config->seed);
+
+  if (config->profile != NULL) {
+    emulator->profile = chip8_profile_new();
+    if (emulator->profile == NULL) {
+      perror("Profile could not be allocated!");
+      chip8_destroy(emulator);
+      return;
+    }
+  }
+
+  initialize_graphics(&screen, &renderer, &window);
+
+  bool load = config->rom != NULL ? chip8_romlib_load(emulator, config->rom)
+                                  : chip8_load_rom(emulator, file_name);
+  if (load == false) {
+    perror("ROM was not loaded successfully!");
+    deinitialize_graphics(screen, renderer, window);
+    chip8_destroy(emulator);
+    return;
+  }
+
+  session.emulator = emulator;
+  frame_buffer_init(&session.frames);
+  session.rewind = chip8_rewind_new(REWIND_FRAMES, REWIND_ARENA_SIZE);
+  session.movie = NULL;
+  if (config->record != NULL) {
+    session.movie = chip8_movie_new(emulator);
+    if (session.movie == NULL) {
+      perror("Movie could not be allocated!");
+    }
+  }
+  session.run_ahead = config->run_ahead;
+  CHIP8_AUDIO audio;
+  session.audio = &audio;
+  if (audio_open(&audio, config->audio_buffer != 0 ? config->audio_buffer
+                                                   : AUDIO_BUFFER_DEFAULT) ==
+      false) {
+    fprintf(stderr, "Audio is unavailable: %s\n", SDL_GetError());
+    session.audio = NULL;
+  }
+  atomic_init(&session.keys, 0);
+  atomic_init(&session.rewinding, false);
+  atomic_init(&session.speed, 1);
+  atomic_init(&session.turbo, false);
+  atomic_init(&session.quit, false);
+  atomic_init(&session.instructions, 0);
+  atomic_init(&session.frames_run, 0);
+  atomic_init(&session.dropped, 0);
+  atomic_init(&session.execute_ticks, 0);
+
+  SDL_Thread* thread = SDL_CreateThread(chip8_emulate, "chip8", &session);
+  if (thread == NULL) {
+    fprintf(stderr, "Emulation thread failed to start: %s\n", SDL_GetError());
+    audio_close(&audio);
+    chip8_rewind_destroy(session.rewind);
+    chip8_movie_destroy(session.movie);
+    deinitialize_graphics(screen, renderer, window);
+    chip8_destroy(emulator);
+    return;
+  }
+
+  // Rows currently in the texture, and rows that must be redrawn anyway
+  uint64_t shown[DISPLAY_HEIGHT] = {0};
+  uint32_t redraw = UINT32_MAX;
+  const CHIP8_FRAME* frame = NULL;
+  CHIP8_HUD hud;
+  CHIP8_HUD_COUNTERS counters = {0};
+
+  if (hud_init(&hud, renderer) == false) {
+    fprintf(stderr, "HUD could not be created: %s\n", SDL_GetError());
+  }
+
+  while (quit == false) {
+    STATS_DECLARE(start);
+    STATS_PHASE_BEGIN(start);
+    while (SDL_PollEvent(&event)) {
+      int key = -1;
+
+      switch (event.type) {
+        case SDL_QUIT:
+          quit = true;
+          break;
+        case SDL_WINDOWEVENT:
+          // Frames without changes are never presented, so redraw everything
+          // when the window needs repainting.
+          if (event.window.event == SDL_WINDOWEVENT_EXPOSED ||
+              event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+            redraw = UINT32_MAX;
+          }
+          break;
+        case SDL_KEYDOWN:
+          if (event.key.keysym.sym == SDLK_ESCAPE) {
+            quit = true;
+            break;
+          }
+
+          if (event.key.keysym.sym == SDLK_BACKSPACE) {
+            atomic_store(&session.rewinding, true);
+            break;
+          }
+
+          if (event.key.keysym.sym == SDLK_F1) {
+            // Measure from now rather than from when it was last shown
+            hud.visible = !hud.visible && hud.texture != NULL;
+            hud.previous.time = 0;
+            redraw = UINT32_MAX;
+            break;
+          }
+
+          if (event.key.keysym.sym == SDLK_F2 ||
+              event.key.keysym.sym == SDLK_F3) {
+            uint_fast8_t speed = chip8_speed_step(
+                atomic_load(&session.speed), event.key.keysym.sym == SDLK_F3);
+            atomic_store(&session.speed, speed);
+            break;
+          }
+
+          if (event.key.keysym.sym == SDLK_TAB) {
+            atomic_store(&session.turbo, true);
+            break;
+          }
+
+          if (event.key.keysym.sym == SDLK_F4) {
+            STATS_DUMP(stderr);
+            break;
+          }
+
+          key = chip8_key_index(event.key.keysym.sym);
+          if (key >= 0) {
+            atomic_fetch_or(&session.keys, 1u << key);
+          }
+          break;
+        case SDL_KEYUP:
+          if (event.key.keysym.sym == SDLK_BACKSPACE) {
+            atomic_store(&session.rewinding, false);
+            break;
+          }
+
+          if (event.key.keysym.sym == SDLK_TAB) {
+            atomic_store(&session.turbo, false);
+            break;
+          }
+
+          key = chip8_key_index(event.key.keysym.sym);
+          if (key >= 0) {
+            atomic_fetch_and(&session.keys, ~(1u << key));
+          }
+          break;
+      }
+    }
+    STATS_PHASE_END(start, PHASE_EVENTS);
+
+    bool refresh = false;
+    if (hud.visible == true) {
+      counters.time = SDL_GetPerformanceCounter();
+      counters.instructions = atomic_load_explicit(&session.instructions,
+                                                   memory_order_relaxed);
+      counters.frames = atomic_load_explicit(&session.frames_run,
+                                             memory_order_relaxed);
+      counters.dropped =
+          atomic_load_explicit(&session.dropped, memory_order_relaxed);
+      counters.execute_ticks =
+          atomic_load_explicit(&session.execute_ticks, memory_order_relaxed);
+      counters.speed = atomic_load(&session.turbo) == true
+                           ? SPEED_UNCAPPED
+                           : atomic_load(&session.speed);
+      refresh = hud_sample(&hud, &counters);
+    }
+
+    if (frame_buffer_acquire(&session.frames, &frame) == false &&
+        redraw == 0 && refresh == false) {
+      SDL_Delay(1);
+      continue;
+    }
+
+    uint32_t dirty = redraw;
+    for (size_t y = 0; y < DISPLAY_HEIGHT; y++) {
+      if (frame->rows[y] != shown[y]) {
+        dirty |= UINT32_C(1) << y;
+        shown[y] = frame->rows[y];
+      }
+    }
+
+    if (dirty != 0 || refresh == true) {
+      uint64_t begin = SDL_GetPerformanceCounter();
+      if (dirty != 0) {
+        draw_graphics(screen, shown, dirty);
+      }
+      uint64_t drawn = SDL_GetPerformanceCounter();
+      present_graphics(screen, renderer,
+                       hud.visible == true ? hud.texture : NULL);
+      counters.draw_ticks += drawn - begin;
+      counters.present_ticks += SDL_GetPerformanceCounter() - drawn;
+      counters.presents++;
+    }
+    redraw = 0;
+  }
+
+  atomic_store(&session.quit, true);
+  SDL_WaitThread(thread, NULL);
+  audio_close(&audio);
+  chip8_rewind_destroy(session.rewind);
+  hud_destroy(&hud);
+  STATS_DUMP(stderr);
+
+  if (session.movie != NULL) {
+    chip8_movie_finish(session.movie, emulator);
+    if (chip8_movie_save(session.movie, config->record) == false) {
+      fprintf(stderr, "Movie %s could not be written\n", config->record);
+    } else {
+      printf("Recorded %llu frames, state hash 0x%016llX\n",
+             (unsigned long long)session.movie->frames,
+             (unsigned long long)session.movie->state_hash);
+    }
+    chip8_movie_destroy(session.movie);
+  }
+
+  if (emulator->profile != NULL) {
+    if (chip8_profile_save_folded(emulator->profile, config->profile) ==
+        false) {
+      fprintf(stderr, "Profile %s could not be written\n", config->profile);
+    }
+    chip8_profile_report(emulator->profile, stderr);
+  }
+
+  deinitialize_graphics(screen, renderer, window);
+  chip8_destroy(emulator);
+}
+
+/**
+ * @brief Draws the rows of the screen that changed since the last draw
+ * @param emulator: a pointer to the CHIP-8 emulator
+ * @param screen: a pointer to the streaming texture
+ * @param renderer: a pointer to the renderer
+ * @returns void
+ */
+void chip8_draw(CHIP8* emulator, SDL_Texture* screen, SDL_Renderer* renderer) {
+  if (emulator->dirty_rows == 0) {
+    return;
+  }
+
+  update_graphics(screen, renderer, emulator->display, emulator->dirty_rows);
+  emulator->dirty_rows = 0;
+}
@@ -4,6 +4,7 @@
 
 #include "../include/graphics.h"
 #include "../include/chip8.h"
+#include "../include/frame.h"
 
 /**
  * @brief Initialize SDL2 for the emulator
@@ -14,7 +15,7 @@
  */
 void initialize_graphics(SDL_Texture** screen, SDL_Renderer** renderer,
                          SDL_Window** window) {
-  if (SDL_Init(SDL_INIT_EVERYTHING) != 0) {
+  if (SDL_Init(SDL_INIT_VIDEO) != 0) {
     fprintf(stderr, "SDL failed to initialise: %s\n", SDL_GetError());
     exit(EXIT_FAILURE);
   }
@@ -49,21 +50,70 @@ void deinitialize_graphics(SDL_Texture* screen, SDL_Renderer* renderer,
 }
 
 /**
- * @brief Updates the texture and the current window
- * @param screen: a pointer to an SDL_Texture pointer
- * @param renderer: a pointer to an SDL_Renderer pointer
- * @param pixels: list of pixels for the texture
+ * @brief Writes changed display rows into the texture
+ * @param screen: a pointer to the streaming texture
+ * @param display: the display, one word per row with column 0 in the top bit
+ * @param dirty_rows: one bit per row that changed, at least one
  * @returns void
+ *
+ * Only the span from the first to the last dirty row is locked. Locked
+ * texture memory is write-only, so every row inside the span is expanded.
  */
-void update_graphics(SDL_Texture* screen, SDL_Renderer* renderer,
-                     uint32_t* pixels) {
-  SDL_UpdateTexture(screen, NULL, pixels, DISPLAY_WIDTH * sizeof(uint32_t));
+void draw_graphics(SDL_Texture* screen, const uint64_t* display,
+                   uint32_t dirty_rows) {
+  int first = __builtin_ctz(dirty_rows);
+  int last = 31 - __builtin_clz(dirty_rows);
+  SDL_Rect span = {0, first, DISPLAY_WIDTH, last - first + 1};
+  void* pixels = NULL;
+  int pitch = 0;
+  STATS_DECLARE(start);
+
+  STATS_PHASE_BEGIN(start);
+  if (SDL_LockTexture(screen, &span, &pixels, &pitch) != 0) {
+    return;
+  }
 
+  expand_rows(pixels, pitch, display, first, last);
+
+  SDL_UnlockTexture(screen);
+  STATS_PHASE_END(start, PHASE_DRAW);
+}
+
+/**
+ * @brief Presents the texture, with an overlay on top if there is one
+ * @param screen: a pointer to the streaming texture
+ * @param renderer: a pointer to the renderer
+ * @param overlay: a pointer to a texture blended over the display, or NULL
+ * @returns void
+ */
+void present_graphics(SDL_Texture* screen, SDL_Renderer* renderer,
+                      SDL_Texture* overlay) {
+  STATS_DECLARE(start);
+
+  STATS_PHASE_BEGIN(start);
   SDL_Rect position;
   position.x = 0;
   position.y = 0;
   position.w = DISPLAY_WIDTH;
   position.h = DISPLAY_HEIGHT;
   SDL_RenderCopy(renderer, screen, NULL, &position);
+  if (overlay != NULL) {
+    SDL_RenderCopy(renderer, overlay, NULL, &position);
+  }
   SDL_RenderPresent(renderer);
+  STATS_PHASE_END(start, PHASE_PRESENT);
+}
+
+/**
+ * @brief Writes changed display rows into the texture and presents it
+ * @param screen: a pointer to the streaming texture
+ * @param renderer: a pointer to the renderer
+ * @param display: the display, one word per row with column 0 in the top bit
+ * @param dirty_rows: one bit per row that changed, at least one
+ * @returns void
+ */
+void update_graphics(SDL_Texture* screen, SDL_Renderer* renderer,
+                     const uint64_t* display, uint32_t dirty_rows) {
+  draw_graphics(screen, display, dirty_rows);
+  present_graphics(screen, renderer, NULL);
 }
@@ -0,0 +1,231 @@
+#include "../include/hud.h"
+#include "../include/chip8.h"
+
+/*
+ * Performance overlay
+ *
+ * The emulation thread only adds to a few counters once per frame, and the
+ * SDL thread turns two snapshots of them into rates a few times a second.
+ * Text is drawn with a 3x5 font into a translucent texture that is copied
+ * over the display before presenting, so nothing is measured or drawn per
+ * instruction and a hidden HUD costs nothing but the counters.
+ */
+
+// Five rows of three pixels, one octal digit per row, top row first
+static const uint16_t hud_digits[10] = {
+    075557, 026227, 071747, 071717, 055711,
+    074717, 074757, 071111, 075757, 075717,
+};
+
+static const uint16_t hud_letters[26] = {
+    025755, 065656, 034443, 065556, 074647, 074644, 034553,
+    055755, 072227, 011152, 055655, 044447, 057755, 065555,
+    025552, 065644, 025563, 065655, 034216, 072222, 055557,
+    055552, 055775, 055255, 055222, 071247,
+};
+
+/**
+ * @brief Looks up the glyph for a character
+ * @param c: the character, letters in either case
+ * @returns the glyph, blank for characters the font does not have
+ */
+static uint16_t hud_glyph(char c) {
+  if (c >= '0' && c <= '9') {
+    return hud_digits[c - '0'];
+  }
+
+  if (c >= 'a' && c <= 'z') {
+    c = c - 'a' + 'A';
+  }
+
+  if (c >= 'A' && c <= 'Z') {
+    return hud_letters[c - 'A'];
+  }
+
+  switch (c) {
+    case '.':
+      return 000002;
+    case ':':
+      return 002020;
+    case '/':
+      return 011244;
+    case '-':
+      return 000700;
+    case '%':
+      return 051245;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * @brief Draws a line of text into the overlay pixels
+ * @param pixels: the overlay, HUD_WIDTH pixels per row
+ * @param x: the column of the top left corner of the first glyph
+ * @param y: the row of the top left corner of the first glyph
+ * @param text: the text to draw, clipped to the overlay
+ * @returns void
+ */
+void hud_print(uint32_t* pixels, int x, int y, const char* text) {
+  for (; *text != '\0'; text++, x += HUD_CELL_WIDTH) {
+    uint16_t glyph = hud_glyph(*text);
+
+    for (int row = 0; row < 5; row++) {
+      for (int column = 0; column < 3; column++) {
+        int px = x + column;
+        int py = y + row;
+        bool set = (glyph >> ((4 - row) * 3 + (2 - column))) & 1;
+
+        if (set == true && px >= 0 && px < HUD_WIDTH && py >= 0 &&
+            py < HUD_HEIGHT) {
+          pixels[py * HUD_WIDTH + px] = HUD_TEXT_COLOR;
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief Turns two snapshots of the counters into rates
+ * @param previous: the older snapshot
+ * @param current: the newer snapshot
+ * @param frequency: performance counter ticks per second
+ * @param stats: a pointer to the numbers to fill in
+ * @returns void
+ */
+void hud_compute(const CHIP8_HUD_COUNTERS* previous,
+                 const CHIP8_HUD_COUNTERS* current, uint64_t frequency,
+                 CHIP8_HUD_STATS* stats) {
+  double seconds = (double)(current->time - previous->time) / frequency;
+  uint64_t frames = current->frames - previous->frames;
+  uint64_t presents = current->presents - previous->presents;
+  double ms_per_tick = 1000.0 / frequency;
+
+  memset(stats, 0, sizeof(CHIP8_HUD_STATS));
+  stats->dropped = current->dropped;
+  stats->limit = current->speed;
+
+  if (seconds > 0) {
+    stats->instructions_per_second =
+        (current->instructions - previous->instructions) / seconds;
+    stats->speed = frames / seconds / FRAME_RATE;
+  }
+
+  if (frames > 0) {
+    stats->execute_ms =
+        (current->execute_ticks - previous->execute_ticks) * ms_per_tick /
+        frames;
+  }
+
+  if (presents > 0) {
+    stats->draw_ms =
+        (current->draw_ticks - previous->draw_ticks) * ms_per_tick / presents;
+    stats->present_ms =
+        (current->present_ticks - previous->present_ticks) * ms_per_tick /
+        presents;
+  }
+}
+
+/**
+ * @brief Formats the numbers shown on the overlay
+ * @param stats: a pointer to the numbers
+ * @param lines: the text of each line
+ * @returns void
+ */
+void hud_format(const CHIP8_HUD_STATS* stats,
+                char lines[HUD_LINES][HUD_COLUMNS + 1]) {
+  snprintf(lines[0], HUD_COLUMNS + 1, "IPS %10.0f",
+           stats->instructions_per_second);
+  snprintf(lines[1], HUD_COLUMNS + 1, "EXEC %6.2f MS", stats->execute_ms);
+  snprintf(lines[2], HUD_COLUMNS + 1, "DRAW %6.2f MS", stats->draw_ms);
+  snprintf(lines[3], HUD_COLUMNS + 1, "PRES %6.2f MS", stats->present_ms);
+  snprintf(lines[4], HUD_COLUMNS + 1, "DROP %9llu",
+           (unsigned long long)stats->dropped);
+  snprintf(lines[5], HUD_COLUMNS + 1, "SPEED %7.2fX", stats->speed);
+  if (stats->limit == SPEED_UNCAPPED) {
+    snprintf(lines[6], HUD_COLUMNS + 1, "LIMIT     NONE");
+  } else {
+    snprintf(lines[6], HUD_COLUMNS + 1, "LIMIT %7uX", stats->limit);
+  }
+}
+
+/**
+ * @brief Creates the overlay texture
+ * @param hud: a pointer to the HUD
+ * @param renderer: a pointer to the renderer it is drawn with
+ * @returns a boolean that indicates success
+ *
+ * The HUD starts hidden.
+ */
+bool hud_init(CHIP8_HUD* hud, SDL_Renderer* renderer) {
+  memset(hud, 0, sizeof(CHIP8_HUD));
+  hud->frequency = SDL_GetPerformanceFrequency();
+
+  hud->texture =
+      SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                        SDL_TEXTUREACCESS_STREAMING, HUD_WIDTH, HUD_HEIGHT);
+  if (hud->texture == NULL) {
+    return false;
+  }
+
+  SDL_SetTextureBlendMode(hud->texture, SDL_BLENDMODE_BLEND);
+
+  return true;
+}
+
+/**
+ * @brief Frees the overlay texture
+ * @param hud: a pointer to the HUD
+ * @returns void
+ */
+void hud_destroy(CHIP8_HUD* hud) {
+  if (hud->texture != NULL) {
+    SDL_DestroyTexture(hud->texture);
+    hud->texture = NULL;
+  }
+}
+
+/**
+ * @brief Redraws the overlay when its numbers are due for a refresh
+ * @param hud: a pointer to the HUD
+ * @param current: a snapshot of the counters taken now
+ * @returns a boolean that indicates whether the overlay changed
+ *
+ * The first snapshot only starts the measurement.
+ */
+bool hud_sample(CHIP8_HUD* hud, const CHIP8_HUD_COUNTERS* current) {
+  if (hud->previous.time == 0) {
+    hud->previous = *current;
+    return false;
+  }
+
+  if (current->time - hud->previous.time < hud->frequency / HUD_UPDATE_RATE) {
+    return false;
+  }
+
+  CHIP8_HUD_STATS stats;
+  char lines[HUD_LINES][HUD_COLUMNS + 1];
+  hud_compute(&hud->previous, current, hud->frequency, &stats);
+  hud_format(&stats, lines);
+  hud->previous = *current;
+
+  memset(hud->pixels, 0, sizeof(hud->pixels));
+  int panel = HUD_LINES * HUD_CELL_HEIGHT + 1;
+  int width = HUD_COLUMNS * HUD_CELL_WIDTH + 1;
+  for (int y = 0; y < panel; y++) {
+    for (int x = 0; x < width; x++) {
+      hud->pixels[y * HUD_WIDTH + x] = HUD_PANEL_COLOR;
+    }
+  }
+
+  for (int i = 0; i < HUD_LINES; i++) {
+    hud_print(hud->pixels, 1, 1 + i * HUD_CELL_HEIGHT, lines[i]);
+  }
+
+  if (hud->texture != NULL) {
+    SDL_UpdateTexture(hud->texture, NULL, hud->pixels,
+                      HUD_WIDTH * sizeof(uint32_t));
+  }
+
+  return true;
+}
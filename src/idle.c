@@ -0,0 +1,176 @@
+#include "../include/idle.h"
+#include "../include/opcodes.h"
+
+/*
+ * Idle loop skipping
+ *
+ * Timers only tick and the keypad only changes between frames, so within a
+ * frame a loop that neither writes memory, the display or the stack nor
+ * consumes random numbers can only end where it began. Jumps to themselves,
+ * FX0A waiting for a key and delay timer polling loops are all like this.
+ * Once one full pass over such a loop leaves the registers as they were,
+ * every further pass would too, so the passes left in the frame are counted
+ * instead of executed. The machine ends the frame exactly as if they had
+ * run, which keeps save states, movies and every backend in agreement.
+ */
+
+/*
+ * The registers one pass over an idle loop may touch. Memory, the display
+ * and the stack are left alone by construction, see chip8_idle_safe().
+ */
+typedef struct {
+    uint8_t V[V_REGISTERS_SIZE];
+    uint16_t I;
+    uint16_t PC;
+    uint8_t delay_timer;
+    uint8_t sound_timer;
+    uint32_t random;
+} CHIP8_IDLE_STATE;
+
+static void chip8_idle_capture(const CHIP8* emulator,
+                               CHIP8_IDLE_STATE* state) {
+  memcpy(state->V, emulator->V, sizeof(state->V));
+  state->I = emulator->I;
+  state->PC = emulator->PC;
+  state->delay_timer = emulator->delay_timer;
+  state->sound_timer = emulator->sound_timer;
+  state->random = emulator->random;
+}
+
+static bool chip8_idle_equal(const CHIP8_IDLE_STATE* a,
+                             const CHIP8_IDLE_STATE* b) {
+  return memcmp(a->V, b->V, sizeof(a->V)) == 0 && a->I == b->I &&
+         a->PC == b->PC && a->delay_timer == b->delay_timer &&
+         a->sound_timer == b->sound_timer && a->random == b->random;
+}
+
+/**
+ * @brief Checks whether an instruction can be part of an idle loop
+ * @param kind: the decoded instruction kind
+ * @returns a boolean that indicates whether it leaves memory, the display
+ * and the stack untouched and cannot fail
+ */
+static bool chip8_idle_safe(uint8_t kind) {
+  switch (kind) {
+    case OP_CLS:
+    case OP_RET:
+    case OP_CALL:
+    case OP_DRW:
+    case OP_LD_B_VX:
+    case OP_LD_I_VX:
+    case OP_INVALID:
+      return false;
+    default:
+      return true;
+  }
+}
+
+static uint16_t chip8_idle_read(const CHIP8* emulator, uint16_t address) {
+  return emulator->memory[address & 0xFFF] << 8 |
+         emulator->memory[(address + 1) & 0xFFF];
+}
+
+static bool chip8_idle_is_poll(uint16_t instruction) {
+  return (instruction & 0xF0FF) == 0xF007;
+}
+
+static bool chip8_idle_is_skip(uint16_t instruction) {
+  switch (instruction & 0xF000) {
+    case 0x3000:
+    case 0x4000:
+      return true;
+    case 0x5000:
+    case 0x9000:
+      return (instruction & 0x000F) == 0;
+    default:
+      return false;
+  }
+}
+
+/**
+ * @brief Checks whether the program counter can be inside an idle loop
+ * @param emulator: a pointer to the CHIP-8 emulator
+ * @returns a boolean that indicates whether a probe is worth running
+ *
+ * Looks at no more than two instructions and executes nothing, so busy code
+ * is not single-stepped. Matches a jump to itself, FX0A, and every
+ * instruction of a delay timer poll: FX07, the skip after it, and a short
+ * jump back to it.
+ */
+static bool chip8_idle_candidate(const CHIP8* emulator) {
+  uint16_t pc = emulator->PC & 0xFFF;
+  uint16_t instruction = chip8_idle_read(emulator, pc);
+
+  if ((instruction & 0xF000) == 0x1000) {
+    uint16_t target = instruction & 0xFFF;
+    return target == pc ||
+           (target < pc && pc - target < IDLE_LOOP_MAX * 2 &&
+            chip8_idle_is_poll(chip8_idle_read(emulator, target)));
+  }
+
+  if ((instruction & 0xF0FF) == 0xF00A) {
+    return true;
+  }
+
+  if (chip8_idle_is_poll(instruction)) {
+    return chip8_idle_is_skip(chip8_idle_read(emulator, pc + 2));
+  }
+
+  return chip8_idle_is_skip(instruction) &&
+         chip8_idle_is_poll(chip8_idle_read(emulator, pc - 2));
+}
+
+/**
+ * @brief Looks for an idle loop at the program counter and fast-forwards
+ * through it
+ * @param emulator: a pointer to the CHIP-8 emulator
+ * @param remaining: the instructions left in the current frame
+ * @param success: set to false if an instruction failed
+ * @returns the number of instructions executed or skipped, at most
+ * remaining
+ *
+ * Returns 0 without executing anything unless chip8_idle_candidate()
+ * finds a possible idle loop. Otherwise executes up to IDLE_LOOP_MAX
+ * instructions while looking. When the registers come back to where they
+ * started, whole passes over the loop are added to emulator->instructions
+ * without running them; fewer instructions than one pass are always left
+ * for the caller to execute.
+ */
+uint32_t chip8_idle_skip(CHIP8* emulator, uint32_t remaining, bool* success) {
+  CHIP8_IDLE_STATE start;
+  CHIP8_IDLE_STATE now;
+  uint32_t executed = 0;
+
+  if (chip8_idle_candidate(emulator) == false) {
+    return 0;
+  }
+
+  chip8_idle_capture(emulator, &start);
+
+  while (executed < IDLE_LOOP_MAX && executed < remaining) {
+    uint16_t pc = emulator->PC & 0xFFF;
+    CHIP8_OP op;
+    chip8_decode(emulator->memory[pc] << 8 |
+                     emulator->memory[(pc + 1) & 0xFFF],
+                 &op);
+    if (chip8_idle_safe(op.kind) == false) {
+      return executed;
+    }
+
+    executed++;
+    if (chip8_execute(emulator, 1) == false) {
+      *success = false;
+      return executed;
+    }
+
+    chip8_idle_capture(emulator, &now);
+    if (chip8_idle_equal(&start, &now)) {
+      uint32_t skipped = (remaining - executed) / executed * executed;
+      emulator->instructions += skipped;
+      emulator->idle_instructions += skipped;
+      return executed + skipped;
+    }
+  }
+
+  return executed;
+}
@@ -0,0 +1,731 @@
+#include "../include/jit.h"
+#include "../include/opcodes.h"
+
+/*
+ * x86-64 JIT
+ *
+ * Hot basic blocks are translated into native code that works on the CHIP8
+ * struct in place (rbx points at the emulator, r13 at the JIT state).
+ * Simple register instructions are emitted inline, everything else calls
+ * the same handler the interpreter would. A block ends at a jump, call,
+ * return, skip, or an instruction that writes memory. Static successors are
+ * linked lazily: a block exits through a patchable jump, and once its target
+ * is compiled the jump is rewritten to go there directly.
+ *
+ * Blocks subtract their length from the instruction budget on entry and
+ * refuse to run if the budget is too small, so the machine state after a
+ * budget matches the interpreter exactly.
+ *
+ * The code buffer is never writable and executable at the same time: it is
+ * mapped read/write, and flipped to read/execute once the trampoline is
+ * written. Compiling a block or linking a jump switches it back to
+ * read/write for the duration of the write.
+ */
+
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+#define JIT_AVAILABLE
+#endif
+
+#ifdef JIT_AVAILABLE
+
+#include <stddef.h>
+#include <sys/mman.h>
+
+// Worst case code size for one block, checked before compiling
+#define JIT_BLOCK_BYTES 4096
+
+struct CHIP8_JIT {
+    // Read and written by compiled code
+    int64_t budget;
+    uint8_t *last_exit;
+
+    uint8_t *code;
+    size_t used;
+    size_t permanent;
+    uint8_t *exit;
+    uint8_t *exit_zero;
+    uint32_t generation;
+
+    // Compiled block and its instruction count per start address
+    uint8_t *entry[MEMORY_SIZE];
+    uint8_t length[MEMORY_SIZE];
+    // Start address + 1 of a block covering each byte, 0 if none
+    uint16_t owner[MEMORY_SIZE];
+    uint16_t heat[MEMORY_SIZE];
+    uint8_t smc[MEMORY_SIZE];
+};
+
+typedef int (*CHIP8_JIT_ENTER)(CHIP8 *emulator, CHIP8_JIT *jit,
+                               const uint8_t *block);
+
+typedef struct {
+    uint8_t *at;
+    uint8_t index;
+} JIT_FIXUP;
+
+#define V_OFFSET(x) ((uint32_t)(offsetof(CHIP8, V) + (x)))
+#define PC_OFFSET ((uint32_t)offsetof(CHIP8, PC))
+#define I_OFFSET ((uint32_t)offsetof(CHIP8, I))
+#define DT_OFFSET ((uint32_t)offsetof(CHIP8, delay_timer))
+#define ST_OFFSET ((uint32_t)offsetof(CHIP8, sound_timer))
+#define BUDGET_OFFSET ((uint32_t)offsetof(CHIP8_JIT, budget))
+#define LAST_EXIT_OFFSET ((uint32_t)offsetof(CHIP8_JIT, last_exit))
+
+#define REG_AL 0
+#define REG_CL 1
+
+/*
+ * Emitter
+ */
+static void emit8(uint8_t** p, uint8_t value) { *(*p)++ = value; }
+
+static void emit16(uint8_t** p, uint16_t value) {
+  memcpy(*p, &value, sizeof(value));
+  *p += sizeof(value);
+}
+
+static void emit32(uint8_t** p, uint32_t value) {
+  memcpy(*p, &value, sizeof(value));
+  *p += sizeof(value);
+}
+
+static void emit64(uint8_t** p, uint64_t value) {
+  memcpy(*p, &value, sizeof(value));
+  *p += sizeof(value);
+}
+
+/**
+ * @brief Points a rel32 field at a target
+ * @param at: the rel32 field, which ends the instruction
+ * @param target: where the instruction should go
+ * @returns void
+ */
+static void patch_rel32(uint8_t* at, const uint8_t* target) {
+  int32_t rel = (int32_t)(target - (at + 4));
+  memcpy(at, &rel, sizeof(rel));
+}
+
+// ModRM for [rbx + disp32]
+static void emit_rbx(uint8_t** p, uint8_t reg, uint32_t disp) {
+  emit8(p, 0x80 | (reg << 3) | 3);
+  emit32(p, disp);
+}
+
+// ModRM for [r13 + disp32], REX.B is emitted by the caller
+static void emit_r13(uint8_t** p, uint8_t reg, uint32_t disp) {
+  emit8(p, 0x80 | (reg << 3) | 5);
+  emit32(p, disp);
+}
+
+// mov reg8, [rbx + disp]
+static void emit_load(uint8_t** p, uint8_t reg, uint32_t disp) {
+  emit8(p, 0x8A);
+  emit_rbx(p, reg, disp);
+}
+
+// mov [rbx + disp], reg8
+static void emit_store(uint8_t** p, uint8_t reg, uint32_t disp) {
+  emit8(p, 0x88);
+  emit_rbx(p, reg, disp);
+}
+
+// <op> al, [rbx + disp] for or/and/xor/add/sub/cmp
+static void emit_alu(uint8_t** p, uint8_t opcode, uint32_t disp) {
+  emit8(p, opcode);
+  emit_rbx(p, REG_AL, disp);
+}
+
+// mov byte [rbx + disp], imm8
+static void emit_store_imm8(uint8_t** p, uint32_t disp, uint8_t value) {
+  emit8(p, 0xC6);
+  emit_rbx(p, 0, disp);
+  emit8(p, value);
+}
+
+// mov word [rbx + disp], imm16
+static void emit_store_imm16(uint8_t** p, uint32_t disp, uint16_t value) {
+  emit8(p, 0x66);
+  emit8(p, 0xC7);
+  emit_rbx(p, 0, disp);
+  emit16(p, value);
+}
+
+// jmp rel32 to a known target
+static void emit_jump(uint8_t** p, const uint8_t* target) {
+  emit8(p, 0xE9);
+  emit32(p, 0);
+  patch_rel32(*p - 4, target);
+}
+
+/**
+ * @brief Leaves compiled code with a status for the dispatcher
+ * @param jit: a pointer to the JIT state
+ * @param p: the emitter cursor
+ * @param status: 0 to keep going, 1 if an instruction failed
+ * @returns void
+ */
+static void emit_exit(CHIP8_JIT* jit, uint8_t** p, uint32_t status) {
+  if (status == 0) {
+    emit_jump(p, jit->exit_zero);
+  } else {
+    emit8(p, 0xB8);  // mov eax, imm32
+    emit32(p, status);
+    emit_jump(p, jit->exit);
+  }
+}
+
+/**
+ * @brief Sets PC and leaves through a jump the dispatcher can link
+ * @param jit: a pointer to the JIT state
+ * @param p: the emitter cursor
+ * @param target: the CHIP-8 address to continue at
+ * @returns void
+ *
+ * The jmp initially falls through to code that records its own address in
+ * last_exit. Linking rewrites it to jump straight into the next block.
+ */
+static void emit_chain(CHIP8_JIT* jit, uint8_t** p, uint16_t target) {
+  emit_store_imm16(p, PC_OFFSET, target);
+
+  emit8(p, 0xE9);
+  emit32(p, 0);
+
+  // lea rax, [rip - 12], the address of the jmp above
+  emit8(p, 0x48);
+  emit8(p, 0x8D);
+  emit8(p, 0x05);
+  emit32(p, (uint32_t)-12);
+
+  // mov [r13 + last_exit], rax
+  emit8(p, 0x49);
+  emit8(p, 0x89);
+  emit_r13(p, 0, LAST_EXIT_OFFSET);
+
+  emit_exit(jit, p, 0);
+}
+
+/**
+ * @brief Calls an instruction handler, leaving on failure
+ * @param emulator: a pointer to the CHIP-8 emulator
+ * @param jit: a pointer to the JIT state
+ * @param p: the emitter cursor
+ * @param address: the CHIP-8 address of the instruction
+ * @param fixup: filled in with the budget refund to patch once the block
+ * length is known
+ * @returns void
+ */
+static void emit_call(CHIP8* emulator, CHIP8_JIT* jit, uint8_t** p,
+                      uint16_t address, JIT_FIXUP* fixup) {
+  const CHIP8_OP* op = &emulator->ops[address];
+  uint64_t handler = 0;
+  uint64_t operand = (uint64_t)(uintptr_t)op;
+
+  memcpy(&handler, &op->handler, sizeof(op->handler));
+
+  // Handlers expect PC to already point past the instruction
+  emit_store_imm16(p, PC_OFFSET, address + 2);
+
+  // mov rdi, rbx
+  emit8(p, 0x48);
+  emit8(p, 0x89);
+  emit8(p, 0xDF);
+  // mov rsi, imm64
+  emit8(p, 0x48);
+  emit8(p, 0xBE);
+  emit64(p, operand);
+  // mov rax, imm64
+  emit8(p, 0x48);
+  emit8(p, 0xB8);
+  emit64(p, handler);
+  // call rax
+  emit8(p, 0xFF);
+  emit8(p, 0xD0);
+  // test al, al
+  emit8(p, 0x84);
+  emit8(p, 0xC0);
+  // jnz over the failure path
+  emit8(p, 0x75);
+  emit8(p, 21);
+
+  // add qword [r13 + budget], imm32 to refund the instructions not run
+  emit8(p, 0x49);
+  emit8(p, 0x81);
+  emit_r13(p, 0, BUDGET_OFFSET);
+  fixup->at = *p;
+  emit32(p, 0);
+  emit_exit(jit, p, 1);
+}
+
+/**
+ * @brief Emits the two-way exit of a skip instruction
+ * @param jit: a pointer to the JIT state
+ * @param p: the emitter cursor
+ * @param condition: the jcc opcode (second byte) taken when skipping
+ * @param address: the CHIP-8 address of the skip instruction
+ * @returns void
+ */
+static void emit_skip(CHIP8_JIT* jit, uint8_t** p, uint8_t condition,
+                      uint16_t address) {
+  emit8(p, 0x0F);
+  emit8(p, condition);
+  emit32(p, 0);
+  uint8_t* taken = *p - 4;
+
+  emit_chain(jit, p, address + 2);
+  patch_rel32(taken, *p);
+  emit_chain(jit, p, address + 4);
+}
+
+/**
+ * @brief Switches the code buffer between writable and executable
+ * @param jit: a pointer to the JIT state
+ * @param writable: true to allow writes, false to allow execution
+ * @returns a boolean that indicates success
+ */
+static bool jit_protect(CHIP8_JIT* jit, bool writable) {
+  int prot = writable == true ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC;
+  return mprotect(jit->code, JIT_CODE_SIZE, prot) == 0;
+}
+
+/**
+ * @brief Compiles the block starting at an address
+ * @param emulator: a pointer to the CHIP-8 emulator
+ * @param jit: a pointer to the JIT state
+ * @param start: the CHIP-8 address of the block
+ * @returns the entry point of the block, or NULL if nothing was compiled
+ */
+static uint8_t* chip8_jit_compile(CHIP8* emulator, CHIP8_JIT* jit,
+                                  uint16_t start) {
+  JIT_FIXUP fixups[JIT_BLOCK_INSTRUCTIONS];
+  size_t fixup_count = 0;
+  uint8_t length = 0;
+  bool terminated = false;
+
+  if (JIT_CODE_SIZE - jit->used < JIT_BLOCK_BYTES) {
+    chip8_jit_flush(jit);
+  }
+
+  uint8_t* entry = jit->code + jit->used;
+  uint8_t* p = entry;
+
+  // cmp qword [r13 + budget], length; jl exit; sub qword [r13 + budget], length
+  emit8(&p, 0x49);
+  emit8(&p, 0x83);
+  emit_r13(&p, 7, BUDGET_OFFSET);
+  uint8_t* check_length = p;
+  emit8(&p, 0);
+  emit8(&p, 0x0F);
+  emit8(&p, 0x8C);
+  emit32(&p, 0);
+  patch_rel32(p - 4, jit->exit_zero);
+  emit8(&p, 0x49);
+  emit8(&p, 0x83);
+  emit_r13(&p, 5, BUDGET_OFFSET);
+  uint8_t* charge_length = p;
+  emit8(&p, 0);
+
+  uint16_t address = start;
+  while (length < JIT_BLOCK_INSTRUCTIONS && terminated == false) {
+    if (address > MEMORY_SIZE - 2) {
+      break;
+    }
+
+    CHIP8_OP* op = &emulator->ops[address];
+    if (op->handler == NULL) {
+      chip8_decode(emulator->memory[address] << 8 | emulator->memory[address + 1],
+                   op);
+    }
+
+    if (op->kind == OP_INVALID) {
+      break;
+    }
+
+    uint8_t x = op->x;
+    uint8_t y = op->y;
+    terminated = true;
+
+    switch (op->kind) {
+      case OP_SYS:
+        terminated = false;
+        break;
+      case OP_LD_BYTE:
+        emit_store_imm8(&p, V_OFFSET(x), op->nn);
+        terminated = false;
+        break;
+      case OP_ADD_BYTE:
+        emit8(&p, 0x80);
+        emit_rbx(&p, 0, V_OFFSET(x));
+        emit8(&p, op->nn);
+        terminated = false;
+        break;
+      case OP_LD_REG:
+        emit_load(&p, REG_AL, V_OFFSET(y));
+        emit_store(&p, REG_AL, V_OFFSET(x));
+        terminated = false;
+        break;
+      case OP_OR:
+      case OP_AND:
+      case OP_XOR:
+        emit_load(&p, REG_AL, V_OFFSET(x));
+        emit_alu(&p, op->kind == OP_OR ? 0x0A : op->kind == OP_AND ? 0x22 : 0x32,
+                 V_OFFSET(y));
+        emit_store(&p, REG_AL, V_OFFSET(x));
+        emit_store_imm8(&p, V_OFFSET(0xF), 0);
+        terminated = false;
+        break;
+      case OP_ADD_REG:
+      case OP_SUB:
+      case OP_SUBN:
+        // The flag is the carry for add and its inverse (no borrow) for sub
+        emit_load(&p, REG_AL, V_OFFSET(op->kind == OP_SUBN ? y : x));
+        emit_alu(&p, op->kind == OP_ADD_REG ? 0x02 : 0x2A,
+                 V_OFFSET(op->kind == OP_SUBN ? x : y));
+        emit8(&p, 0x0F);
+        emit8(&p, op->kind == OP_ADD_REG ? 0x92 : 0x93);  // setc/setnc cl
+        emit8(&p, 0xC1);
+        emit_store(&p, REG_AL, V_OFFSET(x));
+        emit_store(&p, REG_CL, V_OFFSET(0xF));
+        terminated = false;
+        break;
+      case OP_SHR:
+        emit_load(&p, REG_AL, V_OFFSET(y));
+        emit8(&p, 0x88);  // mov cl, al
+        emit8(&p, 0xC1);
+        emit8(&p, 0x80);  // and cl, 1
+        emit8(&p, 0xE1);
+        emit8(&p, 0x01);
+        emit8(&p, 0xD0);  // shr al, 1
+        emit8(&p, 0xE8);
+        emit_store(&p, REG_AL, V_OFFSET(x));
+        emit_store(&p, REG_CL, V_OFFSET(0xF));
+        terminated = false;
+        break;
+      case OP_SHL:
+        emit_load(&p, REG_AL, V_OFFSET(y));
+        emit8(&p, 0x88);  // mov cl, al
+        emit8(&p, 0xC1);
+        emit8(&p, 0xC0);  // shr cl, 7
+        emit8(&p, 0xE9);
+        emit8(&p, 0x07);
+        emit8(&p, 0xD0);  // shl al, 1
+        emit8(&p, 0xE0);
+        emit_store(&p, REG_AL, V_OFFSET(x));
+        emit_store(&p, REG_CL, V_OFFSET(0xF));
+        terminated = false;
+        break;
+      case OP_LD_I:
+        emit_store_imm16(&p, I_OFFSET, op->nnn);
+        terminated = false;
+        break;
+      case OP_LD_VX_DT:
+        emit_load(&p, REG_AL, DT_OFFSET);
+        emit_store(&p, REG_AL, V_OFFSET(x));
+        terminated = false;
+        break;
+      case OP_LD_DT_VX:
+      case OP_LD_ST_VX:
+        emit_load(&p, REG_AL, V_OFFSET(x));
+        emit_store(&p, REG_AL,
+                   op->kind == OP_LD_DT_VX ? DT_OFFSET : ST_OFFSET);
+        terminated = false;
+        break;
+      case OP_CLS:
+      case OP_RND:
+      case OP_DRW:
+      case OP_ADD_I_VX:
+      case OP_LD_F_VX:
+      case OP_LD_VX_I:
+        emit_call(emulator, jit, &p, address, &fixups[fixup_count]);
+        fixups[fixup_count++].index = length;
+        terminated = false;
+        break;
+      case OP_JP:
+        emit_chain(jit, &p, op->nnn);
+        break;
+      case OP_CALL:
+        emit_call(emulator, jit, &p, address, &fixups[fixup_count]);
+        fixups[fixup_count++].index = length;
+        emit_chain(jit, &p, op->nnn);
+        break;
+      case OP_SE_BYTE:
+      case OP_SNE_BYTE:
+        emit8(&p, 0x80);  // cmp byte [rbx + V], imm8
+        emit_rbx(&p, 7, V_OFFSET(x));
+        emit8(&p, op->nn);
+        emit_skip(jit, &p, op->kind == OP_SE_BYTE ? 0x84 : 0x85, address);
+        break;
+      case OP_SE_REG:
+      case OP_SNE_REG:
+        emit_load(&p, REG_AL, V_OFFSET(x));
+        emit_alu(&p, 0x3A, V_OFFSET(y));  // cmp al, [rbx + V]
+        emit_skip(jit, &p, op->kind == OP_SE_REG ? 0x84 : 0x85, address);
+        break;
+      default:
+        // Returns, computed jumps, key skips, key waits and memory writes
+        // change PC or code in ways only the dispatcher can follow
+        emit_call(emulator, jit, &p, address, &fixups[fixup_count]);
+        fixups[fixup_count++].index = length;
+        emit_exit(jit, &p, 0);
+        break;
+    }
+
+    jit->owner[address] = start + 1;
+    jit->owner[address + 1] = start + 1;
+    length++;
+    address += 2;
+  }
+
+  if (length == 0) {
+    return NULL;
+  }
+
+  if (terminated == false) {
+    emit_chain(jit, &p, address);
+  }
+
+  *check_length = length;
+  *charge_length = length;
+  for (size_t i = 0; i < fixup_count; i++) {
+    uint32_t refund = length - (fixups[i].index + 1);
+    memcpy(fixups[i].at, &refund, sizeof(refund));
+  }
+
+  jit->used = p - jit->code;
+  jit->entry[start] = entry;
+  jit->length[start] = length;
+
+  return entry;
+}
+
+/**
+ * @brief Creates the JIT state and its executable code buffer
+ * @param void
+ * @returns a pointer to the JIT state, or NULL if no executable memory
+ * could be mapped
+ */
+CHIP8_JIT* chip8_jit_new(void) {
+  CHIP8_JIT* jit = calloc(1, sizeof(CHIP8_JIT));
+  if (jit == NULL) {
+    return NULL;
+  }
+
+  void* code = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (code == MAP_FAILED) {
+    free(jit);
+    return NULL;
+  }
+
+  jit->code = code;
+  uint8_t* p = jit->code;
+
+  // Trampoline: save callee-saved registers, keep rsp 16-byte aligned for
+  // handler calls, and jump into the block
+  emit8(&p, 0x53);  // push rbx
+  emit8(&p, 0x41);  // push r12
+  emit8(&p, 0x54);
+  emit8(&p, 0x41);  // push r13
+  emit8(&p, 0x55);
+  emit8(&p, 0x48);  // mov rbx, rdi
+  emit8(&p, 0x89);
+  emit8(&p, 0xFB);
+  emit8(&p, 0x49);  // mov r13, rsi
+  emit8(&p, 0x89);
+  emit8(&p, 0xF5);
+  emit8(&p, 0xFF);  // jmp rdx
+  emit8(&p, 0xE2);
+
+  jit->exit_zero = p;
+  emit8(&p, 0x31);  // xor eax, eax
+  emit8(&p, 0xC0);
+  jit->exit = p;
+  emit8(&p, 0x41);  // pop r13
+  emit8(&p, 0x5D);
+  emit8(&p, 0x41);  // pop r12
+  emit8(&p, 0x5C);
+  emit8(&p, 0x5B);  // pop rbx
+  emit8(&p, 0xC3);  // ret
+
+  jit->permanent = p - jit->code;
+  jit->used = jit->permanent;
+
+  if (jit_protect(jit, false) == false) {
+    munmap(jit->code, JIT_CODE_SIZE);
+    free(jit);
+    return NULL;
+  }
+
+  return jit;
+}
+
+/**
+ * @brief Frees the JIT state and its code buffer
+ * @param jit: a pointer to the JIT state, may be NULL
+ * @returns void
+ */
+void chip8_jit_destroy(CHIP8_JIT* jit) {
+  if (jit == NULL) {
+    return;
+  }
+
+  munmap(jit->code, JIT_CODE_SIZE);
+  free(jit);
+}
+
+/**
+ * @brief Throws away every compiled block
+ * @param jit: a pointer to the JIT state
+ * @returns void
+ */
+void chip8_jit_flush(CHIP8_JIT* jit) {
+  memset(jit->entry, 0, sizeof(jit->entry));
+  memset(jit->length, 0, sizeof(jit->length));
+  memset(jit->owner, 0, sizeof(jit->owner));
+  jit->used = jit->permanent;
+  jit->generation++;
+}
+
+/**
+ * @brief Drops compiled code that overlaps written memory
+ * @param jit: a pointer to the JIT state
+ * @param address: the first address that was written
+ * @param length: the number of bytes that were written
+ * @returns void
+ *
+ * Writing over a compiled block flushes the whole cache, and a block that
+ * keeps getting overwritten is left to the interpreter.
+ */
+void chip8_jit_invalidate(CHIP8_JIT* jit, uint16_t address, uint16_t length) {
+  bool hit = false;
+
+  if (length >= MEMORY_SIZE) {
+    memset(jit->heat, 0, sizeof(jit->heat));
+    memset(jit->smc, 0, sizeof(jit->smc));
+    chip8_jit_flush(jit);
+    return;
+  }
+
+  for (uint16_t i = 0; i < length; i++) {
+    uint16_t owner = jit->owner[(address + i) & 0xFFF];
+    if (owner != 0) {
+      if (jit->smc[owner - 1] < UINT8_MAX) {
+        jit->smc[owner - 1]++;
+      }
+      hit = true;
+    }
+  }
+
+  if (hit == true) {
+    chip8_jit_flush(jit);
+  }
+}
+
+/**
+ * @brief Executes instructions, running hot blocks as native code
+ * @param emulator: a pointer to the CHIP-8 emulator
+ * @param count: the number of instructions to execute
+ * @returns a boolean that indicates success
+ *
+ * Cold code, self-modifying code and the tail of a budget too short for a
+ * whole block run on the predecoded interpreter.
+ */
+bool chip8_execute_jit(CHIP8* emulator, uint32_t count) {
+  if (emulator->jit == NULL) {
+    if (emulator->jit_failed == true) {
+      return chip8_execute_cached(emulator, count);
+    }
+    emulator->jit = chip8_jit_new();
+    if (emulator->jit == NULL) {
+      emulator->jit_failed = true;
+      return chip8_execute_cached(emulator, count);
+    }
+  }
+
+  CHIP8_JIT* jit = emulator->jit;
+  CHIP8_JIT_ENTER enter;
+  uint8_t* pending = NULL;
+  uint32_t pending_generation = 0;
+
+  memcpy(&enter, &jit->code, sizeof(enter));
+  jit->budget = count;
+
+  while (jit->budget > 0) {
+    uint16_t pc = emulator->PC & 0xFFF;
+    bool aligned = emulator->PC == pc;
+    uint8_t* entry = jit->entry[pc];
+
+    if (entry == NULL && aligned == true && jit->smc[pc] < JIT_SMC_LIMIT &&
+        ++jit->heat[pc] >= JIT_HOT_THRESHOLD &&
+        jit_protect(jit, true) == true) {
+      entry = chip8_jit_compile(emulator, jit, pc);
+      if (jit_protect(jit, false) == false) {
+        // Nothing may be entered while the buffer is not executable
+        chip8_jit_flush(jit);
+        entry = NULL;
+      }
+      if (entry == NULL) {
+        jit->heat[pc] = 0;
+      }
+    }
+
+    if (entry != NULL && aligned == true && jit->length[pc] <= jit->budget) {
+      if (pending != NULL && pending_generation == jit->generation &&
+          jit_protect(jit, true) == true) {
+        patch_rel32(pending + 1, entry);
+        if (jit_protect(jit, false) == false) {
+          chip8_jit_flush(jit);
+          pending = NULL;
+          continue;
+        }
+      }
+
+      int64_t before = jit->budget;
+      uint32_t generation = jit->generation;
+      jit->last_exit = NULL;
+
+      int status = enter(emulator, jit, entry);
+      emulator->instructions += before - jit->budget;
+      if (status != 0) {
+        return false;
+      }
+
+      pending = jit->last_exit;
+      pending_generation = generation;
+      continue;
+    }
+
+    pending = NULL;
+    jit->budget--;
+    if (chip8_execute_cached(emulator, 1) == false) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+#else
+
+CHIP8_JIT* chip8_jit_new(void) { return NULL; }
+
+void chip8_jit_destroy(CHIP8_JIT* jit) { (void)jit; }
+
+void chip8_jit_flush(CHIP8_JIT* jit) { (void)jit; }
+
+void chip8_jit_invalidate(CHIP8_JIT* jit, uint16_t address, uint16_t length) {
+  (void)jit;
+  (void)address;
+  (void)length;
+}
+
+/**
+ * @brief Executes instructions on the interpreter where no JIT exists
+ * @param emulator: a pointer to the CHIP-8 emulator
+ * @param count: the number of instructions to execute
+ * @returns a boolean that indicates success
+ */
+bool chip8_execute_jit(CHIP8* emulator, uint32_t count) {
+  return chip8_execute_cached(emulator, count);
+}
+
+#endif
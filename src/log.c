@@ -39,6 +39,8 @@ static struct {
 } L;
 
 
+int log_threshold = LOG_TRACE;
+
 static const char *level_strings[] = {
         "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"
 };
@@ -102,13 +104,26 @@ void log_set_lock(log_LockFn fn, void *udata) {
 }
 
 
+static void update_threshold(void) {
+    int threshold = L.quiet ? LOG_FATAL + 1 : L.level;
+    for (int i = 0; i < MAX_CALLBACKS && L.callbacks[i].fn; i++) {
+        if (L.callbacks[i].level < threshold) {
+            threshold = L.callbacks[i].level;
+        }
+    }
+    log_threshold = threshold;
+}
+
+
 void log_set_level(int level) {
     L.level = level;
+    update_threshold();
 }
 
 
 void log_set_quiet(bool enable) {
     L.quiet = enable;
+    update_threshold();
 }
 
 
@@ -116,6 +131,7 @@ int log_add_callback(log_LogFn fn, void *udata, int level) {
     for (int i = 0; i < MAX_CALLBACKS; i++) {
         if (!L.callbacks[i].fn) {
             L.callbacks[i] = (Callback) {fn, udata, level};
+            update_threshold();
             return 0;
         }
     }
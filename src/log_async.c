@@ -0,0 +1,314 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../include/log_async.h"
+
+/*
+ * Asynchronous logger
+ *
+ * Every thread that logs gets its own single-producer, single-consumer ring
+ * of fixed-size events, found through a thread-local pointer and linked
+ * into a global list the first time the thread logs. Recording an event
+ * copies the format pointer and integer arguments into the ring and never
+ * waits: when the ring is full the event is counted as dropped instead. A
+ * background thread drains every ring, formats the events and writes them
+ * out, and reports how many each thread dropped.
+ */
+
+typedef struct {
+    // Nanoseconds since log_async_start()
+    uint64_t time;
+    const char *fmt;
+    const char *file;
+    uint64_t args[LOG_ASYNC_ARGS];
+    uint32_t line;
+    uint8_t level;
+    uint8_t count;
+} LOG_ASYNC_EVENT;
+
+typedef struct LOG_ASYNC_RING {
+    LOG_ASYNC_EVENT events[LOG_ASYNC_RING_SIZE];
+    // Written by the owning thread only
+    _Atomic(uint32_t) head;
+    // Written by the writer thread only
+    _Atomic(uint32_t) tail;
+    atomic_uint_fast64_t dropped;
+    // Drops the writer has already reported
+    uint64_t reported;
+    uint32_t thread;
+    struct LOG_ASYNC_RING *next;
+} LOG_ASYNC_RING;
+
+static struct {
+    FILE *fp;
+    pthread_t writer;
+    uint64_t start;
+    atomic_bool running;
+    // Rings of every thread that has logged, newest first
+    _Atomic(LOG_ASYNC_RING *) rings;
+    atomic_uint threads;
+    // Bumped when the rings are freed, so threads make new ones
+    atomic_uint generation;
+} A;
+
+atomic_int log_async_threshold = LOG_FATAL + 1;
+
+static _Thread_local LOG_ASYNC_RING *local_ring;
+static _Thread_local unsigned local_generation;
+
+static uint64_t log_async_now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Gets the calling thread's ring, creating it on first use
+ * @param void
+ * @returns a pointer to the ring, or NULL if allocation failed
+ */
+static LOG_ASYNC_RING* log_async_ring(void) {
+  unsigned generation =
+      atomic_load_explicit(&A.generation, memory_order_acquire);
+
+  if (local_ring != NULL && local_generation == generation) {
+    return local_ring;
+  }
+
+  LOG_ASYNC_RING* ring = calloc(1, sizeof(LOG_ASYNC_RING));
+  if (ring == NULL) {
+    return NULL;
+  }
+
+  ring->thread = atomic_fetch_add(&A.threads, 1);
+  ring->next = atomic_load(&A.rings);
+  while (atomic_compare_exchange_weak(&A.rings, &ring->next, ring) == false) {
+  }
+
+  local_ring = ring;
+  local_generation = generation;
+
+  return ring;
+}
+
+/**
+ * @brief Formats one event on the writer thread
+ * @param event: a pointer to the event
+ * @param thread: the number of the thread that recorded it
+ * @returns void
+ */
+static void log_async_print(const LOG_ASYNC_EVENT* event, uint32_t thread) {
+  const unsigned long long* args = (const unsigned long long*)event->args;
+
+  fprintf(A.fp, "%12.6f %-5s %2u %s:%u: ", event->time / 1e9,
+          log_level_string(event->level), thread, event->file, event->line);
+
+  switch (event->count) {
+    case 0:
+      // The argument is never read, it only keeps -Wformat-security quiet
+      fprintf(A.fp, event->fmt, 0ULL);
+      break;
+    case 1:
+      fprintf(A.fp, event->fmt, args[0]);
+      break;
+    case 2:
+      fprintf(A.fp, event->fmt, args[0], args[1]);
+      break;
+    case 3:
+      fprintf(A.fp, event->fmt, args[0], args[1], args[2]);
+      break;
+    default:
+      fprintf(A.fp, event->fmt, args[0], args[1], args[2], args[3]);
+      break;
+  }
+
+  // Formats carried over from log_log() may already end in a newline
+  size_t length = strlen(event->fmt);
+  if (length == 0 || event->fmt[length - 1] != '\n') {
+    fputc('\n', A.fp);
+  }
+}
+
+/**
+ * @brief Writes out every queued event and any new drops
+ * @param void
+ * @returns a boolean that indicates whether anything was written
+ */
+static bool log_async_drain(void) {
+  bool written = false;
+
+  for (LOG_ASYNC_RING* ring = atomic_load(&A.rings); ring != NULL;
+       ring = ring->next) {
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    for (; tail != head; tail++) {
+      log_async_print(&ring->events[tail & (LOG_ASYNC_RING_SIZE - 1)],
+                      ring->thread);
+      written = true;
+    }
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
+
+    uint64_t dropped =
+        atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+    if (dropped != ring->reported) {
+      fprintf(A.fp, "%12.6f %-5s %2u dropped %llu events\n",
+              (log_async_now() - A.start) / 1e9, log_level_string(LOG_WARN),
+              ring->thread, (unsigned long long)(dropped - ring->reported));
+      ring->reported = dropped;
+      written = true;
+    }
+  }
+
+  if (written == true) {
+    fflush(A.fp);
+  }
+
+  return written;
+}
+
+static void* log_async_main(void* data) {
+  const struct timespec idle = {0, LOG_ASYNC_IDLE_NS};
+  (void)data;
+
+  while (atomic_load(&A.running) == true) {
+    if (log_async_drain() == false) {
+      nanosleep(&idle, NULL);
+    }
+  }
+
+  // Events recorded before stopping are still written
+  log_async_drain();
+
+  return NULL;
+}
+
+/**
+ * @brief Starts the writer thread
+ * @param fp: the file events are written to, owned by the caller
+ * @param level: the lowest level that is recorded
+ * @returns a boolean that indicates success
+ */
+bool log_async_start(FILE* fp, int level) {
+  if (atomic_load(&A.running) == true) {
+    return false;
+  }
+
+  A.fp = fp;
+  A.start = log_async_now();
+  atomic_store(&A.running, true);
+
+  if (pthread_create(&A.writer, NULL, log_async_main, NULL) != 0) {
+    atomic_store(&A.running, false);
+    return false;
+  }
+
+  atomic_store(&log_async_threshold, level);
+
+  return true;
+}
+
+/**
+ * @brief Writes out every queued event, stops the writer thread and frees
+ * the rings
+ * @param void
+ * @returns void
+ *
+ * Other threads must have stopped logging first.
+ */
+void log_async_stop(void) {
+  if (atomic_exchange(&A.running, false) == false) {
+    return;
+  }
+
+  atomic_store(&log_async_threshold, LOG_FATAL + 1);
+
+  pthread_join(A.writer, NULL);
+
+  LOG_ASYNC_RING* ring = atomic_exchange(&A.rings, NULL);
+  while (ring != NULL) {
+    LOG_ASYNC_RING* next = ring->next;
+    free(ring);
+    ring = next;
+  }
+
+  atomic_fetch_add(&A.generation, 1);
+}
+
+/**
+ * @brief Sets the lowest level that is recorded while the writer runs
+ * @param level: the level
+ * @returns void
+ */
+void log_async_set_level(int level) {
+  if (atomic_load(&A.running) == true) {
+    atomic_store(&log_async_threshold, level);
+  }
+}
+
+/**
+ * @brief Counts the events dropped because a ring was full
+ * @param void
+ * @returns the number of events dropped by every thread since the start
+ */
+uint64_t log_async_dropped(void) {
+  uint64_t dropped = 0;
+
+  for (LOG_ASYNC_RING* ring = atomic_load(&A.rings); ring != NULL;
+       ring = ring->next) {
+    dropped += atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+  }
+
+  return dropped;
+}
+
+/**
+ * @brief Queues an event on the calling thread's ring
+ * @param level: the level of the event
+ * @param file: the source file of the call site
+ * @param line: the line of the call site
+ * @param fmt: a string literal with only ll integer conversions
+ * @param count: how many of the arguments are used
+ * @param a, b, c, d: the arguments
+ * @returns void
+ */
+void log_async_write(int level, const char* file, int line, const char* fmt,
+                     uint8_t count, uint64_t a, uint64_t b, uint64_t c,
+                     uint64_t d) {
+  // Repeated for callers that bypass the macros
+  if (level < atomic_load_explicit(&log_async_threshold,
+                                   memory_order_relaxed)) {
+    return;
+  }
+
+  LOG_ASYNC_RING* ring = log_async_ring();
+  if (ring == NULL) {
+    return;
+  }
+
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+  if (head - tail == LOG_ASYNC_RING_SIZE) {
+    atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+    return;
+  }
+
+  LOG_ASYNC_EVENT* event = &ring->events[head & (LOG_ASYNC_RING_SIZE - 1)];
+  event->time = log_async_now() - A.start;
+  event->fmt = fmt;
+  event->file = file;
+  event->args[0] = a;
+  event->args[1] = b;
+  event->args[2] = c;
+  event->args[3] = d;
+  event->line = line;
+  event->level = level;
+  event->count = count;
+
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
@@ -1,24 +1,307 @@
 #include "../include/main.h"
 
+static void usage(char *program) {
+    printf("Usage: %s [--headless] [--frames <count>] [--cycles <count>] "
+           "[--ipf <count>] [--backend cached|switch|threaded|jit] "
+           "[--load-state <file>] [--save-state <file>] [--run-ahead <frames>] "
+           "[--profile <file>] [--log-level <0-5>] [--seed <number>] "
+           "[--record <file>] [--replay <file>] [--busy-wait] "
+           "[--audio-buffer <samples>] [--romlib <directory|archive>] "
+           "[--list] [--pack <archive>] <file_name>\n",
+           program);
+}
+
+/**
+ * @brief Loads and runs a ROM without initializing SDL
+ * @param file_name: the name of the ROM file
+ * @param config: a pointer to the run configuration
+ * @param frames: the number of frames to run
+ * @param cycles: the maximum number of instructions to execute
+ * @param load_state: a save state to start from, or NULL
+ * @param save_state: a file to save the final state to, or NULL
+ * @param replay: a movie to play back instead of running frames, or NULL
+ * @returns the process exit code
+ */
+static int run_headless(char *file_name, const CHIP8_CONFIG *config,
+                        uint64_t frames, uint64_t cycles,
+                        const char *load_state, const char *save_state,
+                        const char *replay) {
+    CHIP8_MOVIE *movie = NULL;
+    CHIP8 *emulator = chip8_new();
+
+    if (emulator == NULL) {
+        perror("Emulator could not be allocated!");
+        return EXIT_FAILURE;
+    }
+
+    emulator->instructions_per_frame = config->instructions_per_frame;
+    emulator->backend = config->backend;
+    emulator->busy_wait = config->busy_wait;
+    chip8_seed(emulator, config->seed);
+
+    if (config->profile != NULL) {
+        emulator->profile = chip8_profile_new();
+        if (emulator->profile == NULL) {
+            perror("Profile could not be allocated!");
+            chip8_destroy(emulator);
+            return EXIT_FAILURE;
+        }
+    }
+
+    bool load = config->rom != NULL
+                    ? chip8_romlib_load(emulator, config->rom)
+                    : chip8_load_rom(emulator, file_name);
+    if (load == false) {
+        perror("ROM was not loaded successfully!");
+        chip8_destroy(emulator);
+        return EXIT_FAILURE;
+    }
+
+    if (load_state != NULL &&
+        chip8_state_load_file(emulator, load_state) == false) {
+        fprintf(stderr, "Save state %s could not be loaded\n", load_state);
+        chip8_destroy(emulator);
+        return EXIT_FAILURE;
+    }
+
+    if (replay != NULL) {
+        movie = chip8_movie_load(replay);
+        if (movie == NULL || chip8_movie_start(emulator, movie) == false) {
+            fprintf(stderr, "Movie %s could not be replayed on %s\n", replay,
+                    file_name);
+            chip8_movie_destroy(movie);
+            chip8_destroy(emulator);
+            return EXIT_FAILURE;
+        }
+    }
+
+    bool success = true;
+    if (movie != NULL) {
+        success = chip8_movie_replay(emulator, movie);
+        printf("Replayed %llu frames, state hash 0x%016llX %s\n",
+               (unsigned long long) movie->frames,
+               (unsigned long long) chip8_state_hash(emulator),
+               success ? "matches" : "does not match the recording");
+        chip8_movie_destroy(movie);
+    } else if (chip8_run_headless(emulator, frames, cycles) == false) {
+        success = false;
+        uint16_t pc = (emulator->PC - 2) & (MEMORY_SIZE - 1);
+        fprintf(stderr, "Unknown instruction 0x%02X%02X at 0x%04X\n",
+                emulator->memory[pc],
+                emulator->memory[(pc + 1) & (MEMORY_SIZE - 1)], pc);
+    }
+
+    printf("Executed %llu instructions in %llu frames, PC at 0x%04X\n",
+           (unsigned long long) emulator->instructions,
+           (unsigned long long) emulator->frames, emulator->PC);
+    if (emulator->idle_instructions > 0) {
+        printf("Skipped %llu instructions in idle loops\n",
+               (unsigned long long) emulator->idle_instructions);
+    }
+
+    STATS_DUMP(stderr);
+
+    if (emulator->profile != NULL) {
+        if (chip8_profile_save_folded(emulator->profile, config->profile) ==
+            false) {
+            fprintf(stderr, "Profile %s could not be written\n",
+                    config->profile);
+            success = false;
+        }
+        chip8_profile_report(emulator->profile, stderr);
+    }
+
+    if (save_state != NULL &&
+        chip8_state_save_file(emulator, save_state) == false) {
+        fprintf(stderr, "Save state %s could not be written\n", save_state);
+        success = false;
+    }
+
+    chip8_destroy(emulator);
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Lists a ROM library or packs it into an archive
+ * @param library: a pointer to the opened library
+ * @param list: whether to print the index
+ * @param pack: the name of the archive to write, or NULL
+ * @returns the process exit code
+ */
+static int manage_library(const CHIP8_ROMLIB *library, bool list,
+                          const char *pack) {
+    if (list) {
+        for (size_t i = 0; i < library->count; i++) {
+            const CHIP8_ROM *rom = &library->roms[i];
+            printf("%016llX %5u %5u %10lu %s\n",
+                   (unsigned long long) rom->hash, rom->size,
+                   rom->settings.instructions_per_frame,
+                   (unsigned long) rom->settings.seed, rom->name);
+        }
+    }
+
+    if (pack != NULL && chip8_romlib_pack(library, pack) == false) {
+        fprintf(stderr, "Archive %s could not be written\n", pack);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        printf("Usage: %s <file_name>\n", argv[0]);
+    CHIP8_CONFIG config = {
+        .instructions_per_frame = INSTRUCTIONS_PER_FRAME,
+        .backend = BACKEND_CACHED,
+    };
+    bool headless = false;
+    uint64_t frames = HEADLESS_FRAMES;
+    uint64_t cycles = UINT64_MAX;
+    char *file_name = NULL;
+    char *load_state = NULL;
+    char *save_state = NULL;
+    char *replay = NULL;
+    char *romlib = NULL;
+    char *pack = NULL;
+    bool list = false;
+    int log_level = LOG_INFO;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+            cycles = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--ipf") == 0 && i + 1 < argc) {
+            config.instructions_per_frame = strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+            if (chip8_parse_backend(argv[++i], &config.backend) == false) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--run-ahead") == 0 && i + 1 < argc) {
+            unsigned long run_ahead = strtoul(argv[++i], NULL, 0);
+            if (run_ahead > RUN_AHEAD_MAX) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            config.run_ahead = run_ahead;
+        } else if (strcmp(argv[i], "--log-level") == 0 && i + 1 < argc) {
+            log_level = strtol(argv[++i], NULL, 0);
+            if (log_level < LOG_TRACE || log_level > LOG_FATAL) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            config.seed = strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            config.record = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay = argv[++i];
+            headless = true;
+        } else if (strcmp(argv[i], "--audio-buffer") == 0 && i + 1 < argc) {
+            unsigned long samples = strtoul(argv[++i], NULL, 0);
+            // SDL wants a power of two
+            if (samples < AUDIO_BUFFER_MIN || samples > AUDIO_BUFFER_MAX ||
+                (samples & (samples - 1)) != 0) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            config.audio_buffer = samples;
+        } else if (strcmp(argv[i], "--romlib") == 0 && i + 1 < argc) {
+            romlib = argv[++i];
+        } else if (strcmp(argv[i], "--list") == 0) {
+            list = true;
+        } else if (strcmp(argv[i], "--pack") == 0 && i + 1 < argc) {
+            pack = argv[++i];
+        } else if (strcmp(argv[i], "--busy-wait") == 0) {
+            config.busy_wait = true;
+        } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            config.profile = argv[++i];
+        } else if (strcmp(argv[i], "--load-state") == 0 && i + 1 < argc) {
+            load_state = argv[++i];
+        } else if (strcmp(argv[i], "--save-state") == 0 && i + 1 < argc) {
+            save_state = argv[++i];
+        } else if (file_name == NULL && argv[i][0] != '-') {
+            file_name = argv[i];
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Listing and packing a library need no ROM to run
+    bool manage = list || pack != NULL;
+    if ((manage && romlib == NULL) ||
+        (file_name == NULL && manage == false)) {
+        usage(argv[0]);
         return EXIT_FAILURE;
     }
 
+    // Movies start at power-on and only record live input
+    if (config.instructions_per_frame == 0 ||
+        (replay != NULL && load_state != NULL) ||
+        (config.record != NULL && headless)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    CHIP8_ROMLIB *library = NULL;
+    if (romlib != NULL) {
+        library = chip8_romlib_open(romlib);
+        if (library == NULL) {
+            fprintf(stderr, "ROM library %s could not be opened\n", romlib);
+            return EXIT_FAILURE;
+        }
+
+        if (manage) {
+            int status = manage_library(library, list, pack);
+            chip8_romlib_close(library);
+            return status;
+        }
+
+        config.rom = chip8_romlib_lookup(library, file_name);
+        if (config.rom == NULL) {
+            fprintf(stderr, "ROM %s is not in %s\n", file_name, romlib);
+            chip8_romlib_close(library);
+            return EXIT_FAILURE;
+        }
+    }
+
     // Debug file
     FILE *fp = fopen("chipcraft.log", "w+");
     if (!fp) {
         perror("File opening failed");
+        chip8_romlib_close(library);
         return EXIT_FAILURE;
     }
 
-    log_add_fp(fp, 0);
+    log_add_fp(fp, log_level);
     log_set_quiet(true);
 
-    // Start the emulator
-    chip8_run(argv[1]);
+    // Events from the emulator are written by a background thread
+    if (log_async_start(fp, log_level) == false) {
+        fprintf(stderr, "Logging thread failed to start\n");
+    }
 
-    return EXIT_SUCCESS;
-}
+    int status = EXIT_SUCCESS;
+    if (headless) {
+        status = run_headless(file_name, &config, frames, cycles, load_state,
+                              save_state, replay);
+    } else {
+        // Start the emulator
+        chip8_run(file_name, &config);
+    }
 
+    uint64_t dropped = log_async_dropped();
+    if (dropped > 0) {
+        fprintf(stderr, "%llu log events were dropped\n",
+                (unsigned long long) dropped);
+    }
+    log_async_stop();
+    fclose(fp);
+    chip8_romlib_close(library);
+
+    return status;
+}
@@ -0,0 +1,275 @@
+#include "../include/movie.h"
+
+/*
+ * Input movies
+ *
+ * A movie starts at power-on with the ROM loaded. Recording appends an
+ * event whenever the keypad differs from the previous frame, so a long
+ * session is a few hundred bytes. Nothing else feeds into the machine: the
+ * random number generator is seeded from the movie, and timers run on
+ * emulated frames, not wall time. A replay therefore needs no pacing and
+ * runs as fast as the host allows.
+ */
+
+#define MOVIE_INITIAL_EVENTS 256
+
+/**
+ * @brief Starts an empty movie from an emulator at power-on
+ * @param emulator: a pointer to the CHIP-8 emulator with a ROM loaded
+ * @returns a pointer to the movie, or NULL if allocation failed
+ */
+CHIP8_MOVIE* chip8_movie_new(const CHIP8* emulator) {
+  CHIP8_MOVIE* movie = calloc(1, sizeof(CHIP8_MOVIE));
+  if (movie == NULL) {
+    return NULL;
+  }
+
+  movie->seed = emulator->seed;
+  movie->instructions_per_frame = emulator->instructions_per_frame;
+  movie->rom_hash = chip8_hash_bytes(emulator->memory, MEMORY_SIZE);
+
+  return movie;
+}
+
+/**
+ * @brief Frees a movie
+ * @param movie: a pointer to the movie, or NULL
+ * @returns void
+ */
+void chip8_movie_destroy(CHIP8_MOVIE* movie) {
+  if (movie == NULL) {
+    return;
+  }
+
+  free(movie->events);
+  free(movie);
+}
+
+/**
+ * @brief Drops every event at or after a frame
+ * @param movie: a pointer to the movie
+ * @param frame: the first frame to drop
+ * @returns void
+ */
+static void chip8_movie_truncate(CHIP8_MOVIE* movie, uint64_t frame) {
+  while (movie->count > 0 && movie->events[movie->count - 1].frame >= frame) {
+    movie->count--;
+  }
+}
+
+/**
+ * @brief Records the keypad a frame is about to run with
+ * @param movie: a pointer to the movie
+ * @param frame: the number of the frame, emulator->frames before it runs
+ * @param keys: the keypad bitmask
+ * @returns a boolean that indicates success
+ *
+ * A frame earlier than the last one recorded means the session rewound,
+ * so the input recorded after it is discarded.
+ */
+bool chip8_movie_record(CHIP8_MOVIE* movie, uint64_t frame, uint16_t keys) {
+  chip8_movie_truncate(movie, frame);
+
+  uint16_t current = 0;
+  if (movie->count > 0) {
+    current = movie->events[movie->count - 1].keys;
+  }
+
+  if (keys == current) {
+    return true;
+  }
+
+  if (movie->count == movie->capacity) {
+    size_t capacity =
+        movie->capacity > 0 ? movie->capacity * 2 : MOVIE_INITIAL_EVENTS;
+    CHIP8_MOVIE_EVENT* events =
+        realloc(movie->events, capacity * sizeof(CHIP8_MOVIE_EVENT));
+    if (events == NULL) {
+      return false;
+    }
+
+    movie->events = events;
+    movie->capacity = capacity;
+  }
+
+  movie->events[movie->count++] = (CHIP8_MOVIE_EVENT){frame, keys};
+
+  return true;
+}
+
+/**
+ * @brief Ends a recording at the emulator's current frame
+ * @param movie: a pointer to the movie
+ * @param emulator: a pointer to the CHIP-8 emulator that was recorded
+ * @returns void
+ */
+void chip8_movie_finish(CHIP8_MOVIE* movie, const CHIP8* emulator) {
+  chip8_movie_truncate(movie, emulator->frames);
+  movie->frames = emulator->frames;
+  movie->state_hash = chip8_state_hash(emulator);
+}
+
+/**
+ * @brief Writes a movie to a file
+ * @param movie: a pointer to the movie
+ * @param file_name: the name of the file to write
+ * @returns a boolean that indicates success
+ */
+bool chip8_movie_save(const CHIP8_MOVIE* movie, const char* file_name) {
+  uint8_t header[MOVIE_HEADER_SIZE] = {0};
+
+  memcpy(header, MOVIE_MAGIC, 4);
+  state_put16(header + 4, MOVIE_VERSION);
+  state_put32(header + 8, movie->seed);
+  state_put16(header + 12, movie->instructions_per_frame);
+  state_put64(header + 16, movie->rom_hash);
+  state_put64(header + 24, movie->frames);
+  state_put64(header + 32, movie->state_hash);
+  state_put64(header + 40, movie->count);
+
+  FILE* fp = fopen(file_name, "wb");
+  if (fp == NULL) {
+    return false;
+  }
+
+  bool success = fwrite(header, 1, sizeof(header), fp) == sizeof(header);
+  for (size_t i = 0; i < movie->count && success == true; i++) {
+    uint8_t event[MOVIE_EVENT_SIZE] = {0};
+    state_put64(event, movie->events[i].frame);
+    state_put16(event + 8, movie->events[i].keys);
+    success = fwrite(event, 1, sizeof(event), fp) == sizeof(event);
+  }
+
+  return fclose(fp) == 0 && success;
+}
+
+/**
+ * @brief Reads a movie from a file
+ * @param file_name: the name of the file to read
+ * @returns a pointer to the movie, or NULL if it could not be read or is
+ * malformed
+ */
+CHIP8_MOVIE* chip8_movie_load(const char* file_name) {
+  uint8_t header[MOVIE_HEADER_SIZE];
+  CHIP8_MOVIE* movie = NULL;
+
+  FILE* fp = fopen(file_name, "rb");
+  if (fp == NULL) {
+    return NULL;
+  }
+
+  if (fread(header, 1, sizeof(header), fp) != sizeof(header) ||
+      memcmp(header, MOVIE_MAGIC, 4) != 0) {
+    goto fail;
+  }
+
+  uint16_t version = state_get16(header + 4);
+  size_t event_size = version == 1 ? MOVIE_EVENT_SIZE_V1 : MOVIE_EVENT_SIZE;
+  if (version == 0 || version > MOVIE_VERSION) {
+    goto fail;
+  }
+
+  movie = calloc(1, sizeof(CHIP8_MOVIE));
+  if (movie == NULL) {
+    goto fail;
+  }
+
+  movie->seed = state_get32(header + 8);
+  movie->instructions_per_frame = state_get16(header + 12);
+  movie->rom_hash = state_get64(header + 16);
+  movie->frames = state_get64(header + 24);
+  movie->state_hash = state_get64(header + 32);
+  uint64_t count = state_get64(header + 40);
+
+  // Every frame can add at most one event
+  if (count > movie->frames || movie->instructions_per_frame == 0) {
+    goto fail;
+  }
+
+  movie->events = calloc(count > 0 ? count : 1, sizeof(CHIP8_MOVIE_EVENT));
+  if (movie->events == NULL) {
+    goto fail;
+  }
+  movie->capacity = count;
+
+  for (; movie->count < count; movie->count++) {
+    uint8_t event[MOVIE_EVENT_SIZE];
+    if (fread(event, 1, event_size, fp) != event_size) {
+      goto fail;
+    }
+
+    CHIP8_MOVIE_EVENT* current = &movie->events[movie->count];
+    if (version == 1) {
+      current->frame = state_get32(event);
+      current->keys = state_get16(event + 4);
+    } else {
+      current->frame = state_get64(event);
+      current->keys = state_get16(event + 8);
+    }
+
+    // Events must be in frame order and inside the movie
+    if (current->frame >= movie->frames ||
+        (movie->count > 0 && current->frame <= current[-1].frame)) {
+      goto fail;
+    }
+  }
+
+  fclose(fp);
+
+  return movie;
+
+fail:
+  fclose(fp);
+  chip8_movie_destroy(movie);
+
+  return NULL;
+}
+
+/**
+ * @brief Prepares an emulator at power-on to replay a movie
+ * @param emulator: a pointer to the CHIP-8 emulator with a ROM loaded
+ * @param movie: a pointer to the movie
+ * @returns a boolean that indicates whether the emulator starts from the
+ * same memory the movie was recorded from
+ */
+bool chip8_movie_start(CHIP8* emulator, const CHIP8_MOVIE* movie) {
+  if (emulator->frames != 0 ||
+      chip8_hash_bytes(emulator->memory, MEMORY_SIZE) != movie->rom_hash) {
+    return false;
+  }
+
+  chip8_seed(emulator, movie->seed);
+  emulator->instructions_per_frame = movie->instructions_per_frame;
+
+  return true;
+}
+
+/**
+ * @brief Replays a movie as fast as possible
+ * @param emulator: a pointer to the CHIP-8 emulator, see chip8_movie_start
+ * @param movie: a pointer to the movie
+ * @returns a boolean that indicates whether the final state matches the
+ * recording
+ *
+ * Failed instructions do not stop the replay, just as they do not stop a
+ * live session.
+ */
+bool chip8_movie_replay(CHIP8* emulator, const CHIP8_MOVIE* movie) {
+  size_t next = 0;
+  uint16_t keys = 0;
+
+  while (emulator->frames < movie->frames) {
+    while (next < movie->count &&
+           movie->events[next].frame <= emulator->frames) {
+      keys = movie->events[next++].keys;
+    }
+
+    for (size_t i = 0; i < KEYPAD_SIZE; i++) {
+      emulator->keypad[i] = (keys >> i) & 1;
+    }
+
+    chip8_run_frame(emulator);
+  }
+
+  return chip8_state_hash(emulator) == movie->state_hash;
+}
@@ -0,0 +1,168 @@
+#include "../include/opcodes.h"
+
+const CHIP8_HANDLER chip8_handlers[OP_COUNT] = {
+    [OP_CLS] = chip8_op_cls,           [OP_RET] = chip8_op_ret,
+    [OP_SYS] = chip8_op_sys,           [OP_JP] = chip8_op_jp,
+    [OP_CALL] = chip8_op_call,         [OP_SE_BYTE] = chip8_op_se_byte,
+    [OP_SNE_BYTE] = chip8_op_sne_byte, [OP_SE_REG] = chip8_op_se_reg,
+    [OP_LD_BYTE] = chip8_op_ld_byte,   [OP_ADD_BYTE] = chip8_op_add_byte,
+    [OP_LD_REG] = chip8_op_ld_reg,     [OP_OR] = chip8_op_or,
+    [OP_AND] = chip8_op_and,           [OP_XOR] = chip8_op_xor,
+    [OP_ADD_REG] = chip8_op_add_reg,   [OP_SUB] = chip8_op_sub,
+    [OP_SHR] = chip8_op_shr,           [OP_SUBN] = chip8_op_subn,
+    [OP_SHL] = chip8_op_shl,           [OP_SNE_REG] = chip8_op_sne_reg,
+    [OP_LD_I] = chip8_op_ld_i,         [OP_JP_V0] = chip8_op_jp_v0,
+    [OP_RND] = chip8_op_rnd,           [OP_DRW] = chip8_op_drw,
+    [OP_SKP] = chip8_op_skp,           [OP_SKNP] = chip8_op_sknp,
+    [OP_LD_VX_DT] = chip8_op_ld_vx_dt, [OP_LD_VX_K] = chip8_op_ld_vx_k,
+    [OP_LD_DT_VX] = chip8_op_ld_dt_vx, [OP_LD_ST_VX] = chip8_op_ld_st_vx,
+    [OP_ADD_I_VX] = chip8_op_add_i_vx, [OP_LD_F_VX] = chip8_op_ld_f_vx,
+    [OP_LD_B_VX] = chip8_op_ld_b_vx,   [OP_LD_I_VX] = chip8_op_ld_i_vx,
+    [OP_LD_VX_I] = chip8_op_ld_vx_i,   [OP_INVALID] = chip8_op_invalid,
+};
+
+const char* const chip8_opcode_names[OP_COUNT] = {
+    [OP_CLS] = "00E0 CLS",           [OP_RET] = "00EE RET",
+    [OP_SYS] = "0NNN SYS",           [OP_JP] = "1NNN JP",
+    [OP_CALL] = "2NNN CALL",         [OP_SE_BYTE] = "3XNN SE",
+    [OP_SNE_BYTE] = "4XNN SNE",      [OP_SE_REG] = "5XY0 SE",
+    [OP_LD_BYTE] = "6XNN LD",        [OP_ADD_BYTE] = "7XNN ADD",
+    [OP_LD_REG] = "8XY0 LD",         [OP_OR] = "8XY1 OR",
+    [OP_AND] = "8XY2 AND",           [OP_XOR] = "8XY3 XOR",
+    [OP_ADD_REG] = "8XY4 ADD",       [OP_SUB] = "8XY5 SUB",
+    [OP_SHR] = "8XY6 SHR",           [OP_SUBN] = "8XY7 SUBN",
+    [OP_SHL] = "8XYE SHL",           [OP_SNE_REG] = "9XY0 SNE",
+    [OP_LD_I] = "ANNN LD I",         [OP_JP_V0] = "BNNN JP V0",
+    [OP_RND] = "CXNN RND",           [OP_DRW] = "DXYN DRW",
+    [OP_SKP] = "EX9E SKP",           [OP_SKNP] = "EXA1 SKNP",
+    [OP_LD_VX_DT] = "FX07 LD DT",    [OP_LD_VX_K] = "FX0A LD K",
+    [OP_LD_DT_VX] = "FX15 LD DT",    [OP_LD_ST_VX] = "FX18 LD ST",
+    [OP_ADD_I_VX] = "FX1E ADD I",    [OP_LD_F_VX] = "FX29 LD F",
+    [OP_LD_B_VX] = "FX33 LD B",      [OP_LD_I_VX] = "FX55 LD [I]",
+    [OP_LD_VX_I] = "FX65 LD [I]",    [OP_INVALID] = "invalid",
+};
+
+/**
+ * @brief Works out which instruction form an instruction is
+ * @param instruction: the raw instruction
+ * @returns the instruction form
+ */
+static CHIP8_OPCODE chip8_decode_kind(uint16_t instruction) {
+  uint8_t category = (instruction & 0xF000) >> 12;
+  uint8_t y = (instruction & 0x00F0) >> 4;
+  uint8_t n = (instruction & 0x000F);
+  uint16_t nn = instruction & 0x00FF;
+  uint16_t nnn = instruction & 0x0FFF;
+
+  switch (category) {
+    case 0x0:
+      switch (nnn) {
+        case 0x0E0:
+          return OP_CLS;
+        case 0x0EE:
+          return OP_RET;
+        default:
+          return OP_SYS;
+      }
+    case 0x1:
+      return OP_JP;
+    case 0x2:
+      return OP_CALL;
+    case 0x3:
+      return OP_SE_BYTE;
+    case 0x4:
+      return OP_SNE_BYTE;
+    case 0x5:
+      return OP_SE_REG;
+    case 0x6:
+      return OP_LD_BYTE;
+    case 0x7:
+      return OP_ADD_BYTE;
+    case 0x8:
+      switch (n) {
+        case 0x0:
+          return OP_LD_REG;
+        case 0x1:
+          return OP_OR;
+        case 0x2:
+          return OP_AND;
+        case 0x3:
+          return OP_XOR;
+        case 0x4:
+          return OP_ADD_REG;
+        case 0x5:
+          return OP_SUB;
+        case 0x6:
+          return OP_SHR;
+        case 0x7:
+          return OP_SUBN;
+        case 0xE:
+          return OP_SHL;
+        default:
+          return OP_INVALID;
+      }
+    case 0x9:
+      return OP_SNE_REG;
+    case 0xA:
+      return OP_LD_I;
+    case 0xB:
+      return OP_JP_V0;
+    case 0xC:
+      return OP_RND;
+    case 0xD:
+      return OP_DRW;
+    case 0xE:
+      switch (y) {
+        case 0x9:
+          return OP_SKP;
+        case 0xA:
+          return OP_SKNP;
+        default:
+          return OP_INVALID;
+      }
+    case 0xF:
+      switch (nn) {
+        case 0x07:
+          return OP_LD_VX_DT;
+        case 0x0A:
+          return OP_LD_VX_K;
+        case 0x15:
+          return OP_LD_DT_VX;
+        case 0x18:
+          return OP_LD_ST_VX;
+        case 0x1E:
+          return OP_ADD_I_VX;
+        case 0x29:
+          return OP_LD_F_VX;
+        case 0x33:
+          return OP_LD_B_VX;
+        case 0x55:
+          return OP_LD_I_VX;
+        case 0x65:
+          return OP_LD_VX_I;
+        default:
+          return OP_INVALID;
+      }
+    default:
+      return OP_INVALID;
+  }
+}
+
+/**
+ * @brief Decodes an instruction into its handler and operands
+ * @param instruction: the raw instruction
+ * @param op: a pointer to the decoded instruction to fill in
+ * @returns void
+ */
+void chip8_decode(uint16_t instruction, CHIP8_OP* op) {
+  CHIP8_OPCODE kind = chip8_decode_kind(instruction);
+
+  op->kind = kind;
+  op->x = (instruction & 0x0F00) >> 8;
+  op->y = (instruction & 0x00F0) >> 4;
+  op->n = (instruction & 0x000F);
+  op->nn = instruction & 0x00FF;
+  op->nnn = instruction & 0x0FFF;
+  op->dispatch = kind;
+  op->handler = chip8_handlers[kind];
+}
@@ -0,0 +1,412 @@
+#include "../include/profiler.h"
+#include "../include/opcodes.h"
+
+/*
+ * Hot spot profiler
+ *
+ * Every executed instruction is counted against its address, and against
+ * the node of a call tree that mirrors the emulator stack: 2NNN moves down
+ * to a child for the called address, 00EE moves back up. A node's own count
+ * is the exclusive cost of that call chain, and its subtree the inclusive
+ * cost. Counts per (node, address) pair are kept in an open-addressed table
+ * so the folded output can end every stack in the exact addresses that ran.
+ */
+
+// Frame names are at most "sub_FFF;" long
+#define PROFILE_FRAME 8
+#define PROFILE_SITE_LIMIT (PROFILE_SITES / 4 * 3)
+
+typedef struct {
+    // Entry address of the subroutine, 0 for the root
+    uint16_t address;
+    uint32_t parent;
+    // First child and next sibling, 0 for none since the root is nobody's
+    uint32_t child;
+    uint32_t sibling;
+    uint64_t calls;
+    // Instructions executed while this node was on top of the call stack
+    uint64_t self;
+} PROFILE_NODE;
+
+typedef struct {
+    // (node << 12 | address) + 1, or 0 if the slot is free
+    uint32_t key;
+    uint64_t count;
+} PROFILE_SITE;
+
+typedef struct {
+    uint16_t address;
+    uint64_t calls;
+    uint64_t exclusive;
+    uint64_t inclusive;
+} PROFILE_ROW;
+
+struct CHIP8_PROFILE {
+    uint64_t hits[MEMORY_SIZE];
+
+    PROFILE_NODE nodes[PROFILE_NODES];
+    uint32_t node_count;
+    uint32_t current;
+    // Calls made after the node pool filled up, undone by their returns
+    uint32_t overflow;
+
+    PROFILE_SITE sites[PROFILE_SITES];
+    uint32_t site_count;
+};
+
+/**
+ * @brief Creates an empty profile
+ * @param void
+ * @returns a pointer to the profile, or NULL if allocation failed
+ */
+CHIP8_PROFILE* chip8_profile_new(void) {
+  CHIP8_PROFILE* profile = malloc(sizeof(CHIP8_PROFILE));
+  if (profile == NULL) {
+    return NULL;
+  }
+
+  chip8_profile_reset(profile);
+
+  return profile;
+}
+
+/**
+ * @brief Frees a profile created with chip8_profile_new
+ * @param profile: a pointer to the profile
+ * @returns void
+ */
+void chip8_profile_destroy(CHIP8_PROFILE* profile) { free(profile); }
+
+/**
+ * @brief Discards every count and the call tree
+ * @param profile: a pointer to the profile
+ * @returns void
+ */
+void chip8_profile_reset(CHIP8_PROFILE* profile) {
+  memset(profile, 0, sizeof(CHIP8_PROFILE));
+  profile->node_count = 1;
+}
+
+/**
+ * @brief Counts one instruction at an address in the current call chain
+ * @param profile: a pointer to the profile
+ * @param address: the address of the instruction
+ * @returns void
+ */
+static void chip8_profile_record(CHIP8_PROFILE* profile, uint16_t address) {
+  uint32_t key = (profile->current << 12 | address) + 1;
+  uint32_t slot = (key * UINT32_C(2654435761)) >> (32 - PROFILE_SITE_BITS);
+
+  profile->hits[address]++;
+  profile->nodes[profile->current].self++;
+
+  while (profile->sites[slot].key != key) {
+    if (profile->sites[slot].key == 0) {
+      // A full table still counts the node, just not the address within it
+      if (profile->site_count >= PROFILE_SITE_LIMIT) {
+        return;
+      }
+
+      profile->sites[slot].key = key;
+      profile->site_count++;
+      break;
+    }
+
+    slot = (slot + 1) & (PROFILE_SITES - 1);
+  }
+
+  profile->sites[slot].count++;
+}
+
+/**
+ * @brief Moves down the call tree after a call
+ * @param profile: a pointer to the profile
+ * @param address: the address that was called
+ * @returns void
+ */
+static void chip8_profile_enter(CHIP8_PROFILE* profile, uint16_t address) {
+  PROFILE_NODE* parent = &profile->nodes[profile->current];
+  uint32_t child = parent->child;
+
+  if (profile->overflow > 0) {
+    profile->overflow++;
+    return;
+  }
+
+  while (child != 0 && profile->nodes[child].address != address) {
+    child = profile->nodes[child].sibling;
+  }
+
+  if (child == 0) {
+    if (profile->node_count == PROFILE_NODES) {
+      profile->overflow++;
+      return;
+    }
+
+    child = profile->node_count++;
+    profile->nodes[child].address = address;
+    profile->nodes[child].parent = profile->current;
+    profile->nodes[child].sibling = parent->child;
+    parent->child = child;
+  }
+
+  profile->nodes[child].calls++;
+  profile->current = child;
+}
+
+/**
+ * @brief Moves up the call tree after a return
+ * @param profile: a pointer to the profile
+ * @returns void
+ */
+static void chip8_profile_leave(CHIP8_PROFILE* profile) {
+  if (profile->overflow > 0) {
+    profile->overflow--;
+  } else if (profile->current != 0) {
+    profile->current = profile->nodes[profile->current].parent;
+  }
+}
+
+/**
+ * @brief Executes instructions one at a time, counting each one
+ * @param emulator: a pointer to the CHIP-8 emulator with a profile attached
+ * @param count: the number of instructions to execute
+ * @returns a boolean that indicates success
+ *
+ * Runs on the cached interpreter whatever the configured backend, since
+ * compiled code gives no way to see single instructions.
+ */
+bool chip8_execute_profiled(CHIP8* emulator, uint32_t count) {
+  CHIP8_PROFILE* profile = emulator->profile;
+
+  for (uint32_t i = 0; i < count; i++) {
+    uint16_t address = emulator->PC & 0xFFF;
+
+    chip8_profile_record(profile, address);
+    if (chip8_execute_cached(emulator, 1) == false) {
+      return false;
+    }
+
+    // Calls and returns never write memory, so the entry is still decoded
+    if (emulator->ops[address].kind == OP_CALL) {
+      chip8_profile_enter(profile, emulator->PC & 0xFFF);
+    } else if (emulator->ops[address].kind == OP_RET) {
+      chip8_profile_leave(profile);
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @brief Gets the number of instructions executed at an address
+ * @param profile: a pointer to the profile
+ * @param address: the address to look up
+ * @returns the count over every call chain
+ */
+uint64_t chip8_profile_hits(const CHIP8_PROFILE* profile, uint16_t address) {
+  return profile->hits[address & 0xFFF];
+}
+
+static int compare_sites(const void* a, const void* b) {
+  uint32_t x = ((const PROFILE_SITE*)a)->key;
+  uint32_t y = ((const PROFILE_SITE*)b)->key;
+
+  return (x > y) - (x < y);
+}
+
+/**
+ * @brief Writes the folded stacks of a node and everything below it
+ * @param profile: a pointer to the profile
+ * @param fp: the file to write to
+ * @param node: the index of the node
+ * @param sites: the used sites, sorted by key
+ * @param first: for every node, the index of its first site in sites
+ * @param path: the frames above the node, with room for the whole tree
+ * @param length: the length of path
+ * @returns void
+ */
+static void chip8_profile_fold(const CHIP8_PROFILE* profile, FILE* fp,
+                               uint32_t node, const PROFILE_SITE* sites,
+                               const uint32_t* first, char* path,
+                               size_t length) {
+  const PROFILE_NODE* current = &profile->nodes[node];
+  uint64_t attributed = 0;
+
+  if (node == 0) {
+    length += sprintf(path + length, "main");
+  } else {
+    length += sprintf(path + length, ";sub_%03X", current->address);
+  }
+
+  for (uint32_t i = first[node]; i < first[node + 1]; i++) {
+    fprintf(fp, "%s;pc_%03X %llu\n", path, (sites[i].key - 1) & 0xFFF,
+            (unsigned long long)sites[i].count);
+    attributed += sites[i].count;
+  }
+
+  if (current->self > attributed) {
+    fprintf(fp, "%s %llu\n", path,
+            (unsigned long long)(current->self - attributed));
+  }
+
+  for (uint32_t child = current->child; child != 0;
+       child = profile->nodes[child].sibling) {
+    chip8_profile_fold(profile, fp, child, sites, first, path, length);
+  }
+}
+
+/**
+ * @brief Writes the profile as folded stacks, one line per call chain and
+ * address, for flame graph tools
+ * @param profile: a pointer to the profile
+ * @param fp: the file to write to
+ * @returns a boolean that indicates success
+ */
+bool chip8_profile_write_folded(const CHIP8_PROFILE* profile, FILE* fp) {
+  PROFILE_SITE* sites = malloc(sizeof(PROFILE_SITE) * PROFILE_SITES);
+  uint32_t* first = calloc(PROFILE_NODES + 1, sizeof(uint32_t));
+  char* path = malloc((PROFILE_NODES + 1) * PROFILE_FRAME);
+  size_t used = 0;
+
+  if (sites == NULL || first == NULL || path == NULL) {
+    free(sites);
+    free(first);
+    free(path);
+    return false;
+  }
+
+  for (size_t slot = 0; slot < PROFILE_SITES; slot++) {
+    if (profile->sites[slot].key != 0) {
+      sites[used++] = profile->sites[slot];
+    }
+  }
+  qsort(sites, used, sizeof(PROFILE_SITE), compare_sites);
+
+  // Sites of one node are contiguous once sorted
+  for (uint32_t node = 0, i = 0; node <= PROFILE_NODES; node++) {
+    while (i < used && (sites[i].key - 1) >> 12 < node) {
+      i++;
+    }
+    first[node] = i;
+  }
+
+  chip8_profile_fold(profile, fp, 0, sites, first, path, 0);
+
+  free(sites);
+  free(first);
+  free(path);
+
+  return ferror(fp) == 0;
+}
+
+/**
+ * @brief Writes the profile as folded stacks to a file
+ * @param profile: a pointer to the profile
+ * @param file_name: the name of the file to create
+ * @returns a boolean that indicates success
+ */
+bool chip8_profile_save_folded(const CHIP8_PROFILE* profile,
+                               const char* file_name) {
+  FILE* fp = fopen(file_name, "w");
+  if (fp == NULL) {
+    return false;
+  }
+
+  bool success = chip8_profile_write_folded(profile, fp);
+
+  return fclose(fp) == 0 && success;
+}
+
+static int compare_rows(const void* a, const void* b) {
+  uint64_t x = ((const PROFILE_ROW*)a)->inclusive;
+  uint64_t y = ((const PROFILE_ROW*)b)->inclusive;
+
+  return (x < y) - (x > y);
+}
+
+/**
+ * @brief Prints inclusive and exclusive counts per subroutine, and the
+ * hottest addresses
+ * @param profile: a pointer to the profile
+ * @param fp: the file to print to
+ * @returns void
+ *
+ * A subroutine that calls itself is counted once in its own inclusive
+ * total, at the outermost call.
+ */
+void chip8_profile_report(const CHIP8_PROFILE* profile, FILE* fp) {
+  uint64_t* inclusive = calloc(profile->node_count, sizeof(uint64_t));
+  PROFILE_ROW* rows = calloc(MEMORY_SIZE, sizeof(PROFILE_ROW));
+  uint64_t total = profile->nodes[0].self;
+  size_t count = 0;
+
+  if (inclusive == NULL || rows == NULL) {
+    free(inclusive);
+    free(rows);
+    return;
+  }
+
+  // Children are always created after their parent
+  for (uint32_t node = profile->node_count; node-- > 0;) {
+    inclusive[node] += profile->nodes[node].self;
+    if (node != 0) {
+      inclusive[profile->nodes[node].parent] += inclusive[node];
+    }
+  }
+
+  for (uint32_t node = 1; node < profile->node_count; node++) {
+    const PROFILE_NODE* current = &profile->nodes[node];
+    PROFILE_ROW* row = &rows[current->address];
+    uint32_t ancestor = current->parent;
+
+    row->address = current->address;
+    row->calls += current->calls;
+    row->exclusive += current->self;
+    total += current->self;
+
+    while (ancestor != 0 &&
+           profile->nodes[ancestor].address != current->address) {
+      ancestor = profile->nodes[ancestor].parent;
+    }
+    if (ancestor == 0) {
+      row->inclusive += inclusive[node];
+    }
+  }
+
+  for (size_t address = 0; address < MEMORY_SIZE; address++) {
+    if (rows[address].calls > 0) {
+      rows[count++] = rows[address];
+    }
+  }
+  qsort(rows, count, sizeof(PROFILE_ROW), compare_rows);
+
+  fprintf(fp, "%-10s %12s %14s %14s\n", "subroutine", "calls", "exclusive",
+          "inclusive");
+  fprintf(fp, "%-10s %12s %14llu %14llu\n", "main", "-",
+          (unsigned long long)profile->nodes[0].self,
+          (unsigned long long)inclusive[0]);
+  for (size_t i = 0; i < count; i++) {
+    fprintf(fp, "0x%03X      %12llu %14llu %14llu\n", rows[i].address,
+            (unsigned long long)rows[i].calls,
+            (unsigned long long)rows[i].exclusive,
+            (unsigned long long)rows[i].inclusive);
+  }
+
+  // Reuse the rows for the hottest addresses, sorted by their hits
+  for (size_t address = 0; address < MEMORY_SIZE; address++) {
+    rows[address].address = address;
+    rows[address].inclusive = profile->hits[address];
+  }
+  qsort(rows, MEMORY_SIZE, sizeof(PROFILE_ROW), compare_rows);
+
+  fprintf(fp, "%-10s %12s %14s\n", "address", "executed", "share");
+  for (size_t i = 0; i < PROFILE_HOT && rows[i].inclusive > 0; i++) {
+    fprintf(fp, "0x%03X      %12llu %13.2f%%\n", rows[i].address,
+            (unsigned long long)rows[i].inclusive,
+            100.0 * rows[i].inclusive / (total > 0 ? total : 1));
+  }
+
+  free(inclusive);
+  free(rows);
+}
@@ -0,0 +1,302 @@
+#include "../include/rewind.h"
+
+/*
+ * Rewind history
+ *
+ * Every captured frame is a record in a circular byte arena. A keyframe
+ * record is a whole save state. A delta record holds the save state header,
+ * then only the display rows and 64-byte memory pages that changed since
+ * the previous frame, flagged in two bitmasks. Stepping back rebuilds the
+ * previous frame from the nearest keyframe before it. When the arena or the
+ * entry ring is full, the oldest keyframe and its deltas are dropped
+ * together.
+ */
+
+#define REWIND_PAGE 64
+#define REWIND_PAGES (MEMORY_SIZE / REWIND_PAGE)
+#define REWIND_MASKS (sizeof(uint32_t) + sizeof(uint64_t))
+
+typedef struct {
+    uint32_t offset;
+    uint32_t size;
+    bool keyframe;
+} REWIND_ENTRY;
+
+struct CHIP8_REWIND {
+    uint8_t *arena;
+    size_t arena_size;
+    // Where the next record is written
+    size_t head;
+
+    REWIND_ENTRY *entries;
+    size_t capacity;
+    size_t first;
+    size_t count;
+    size_t since_keyframe;
+
+    // The state of the newest record, and room to build the next one
+    uint8_t last[STATE_SIZE];
+    uint8_t record[REWIND_MASKS + STATE_SIZE];
+};
+
+/**
+ * @brief Creates an empty rewind history
+ * @param frames: the most frames to keep
+ * @param arena_size: the most bytes of records to keep
+ * @returns a pointer to the history, or NULL if allocation failed
+ */
+CHIP8_REWIND* chip8_rewind_new(size_t frames, size_t arena_size) {
+  CHIP8_REWIND* rewind = calloc(1, sizeof(CHIP8_REWIND));
+  if (rewind == NULL) {
+    return NULL;
+  }
+
+  rewind->arena = malloc(arena_size);
+  rewind->entries = calloc(frames, sizeof(REWIND_ENTRY));
+  if (rewind->arena == NULL || rewind->entries == NULL || frames == 0) {
+    chip8_rewind_destroy(rewind);
+    return NULL;
+  }
+
+  rewind->arena_size = arena_size;
+  rewind->capacity = frames;
+
+  return rewind;
+}
+
+/**
+ * @brief Frees a rewind history
+ * @param rewind: a pointer to the history, may be NULL
+ * @returns void
+ */
+void chip8_rewind_destroy(CHIP8_REWIND* rewind) {
+  if (rewind == NULL) {
+    return;
+  }
+
+  free(rewind->arena);
+  free(rewind->entries);
+  free(rewind);
+}
+
+/**
+ * @brief Gets the number of frames that can be stepped back through
+ * @param rewind: a pointer to the history
+ * @returns the number of captured frames
+ */
+size_t chip8_rewind_count(const CHIP8_REWIND* rewind) { return rewind->count; }
+
+static REWIND_ENTRY* chip8_rewind_entry(const CHIP8_REWIND* rewind,
+                                        size_t index) {
+  return &rewind->entries[(rewind->first + index) % rewind->capacity];
+}
+
+/**
+ * @brief Drops the oldest keyframe together with the deltas that need it
+ * @param rewind: a pointer to the history
+ * @returns void
+ */
+static void chip8_rewind_evict(CHIP8_REWIND* rewind) {
+  do {
+    rewind->first = (rewind->first + 1) % rewind->capacity;
+    rewind->count--;
+  } while (rewind->count > 0 &&
+           chip8_rewind_entry(rewind, 0)->keyframe == false);
+
+  if (rewind->count == 0) {
+    rewind->head = 0;
+  }
+}
+
+/**
+ * @brief Finds room for a record, evicting old frames as needed
+ * @param rewind: a pointer to the history
+ * @param size: the size of the record
+ * @param offset: set to where the record goes
+ * @returns a boolean that indicates whether the record fits at all
+ */
+static bool chip8_rewind_reserve(CHIP8_REWIND* rewind, size_t size,
+                                 size_t* offset) {
+  if (size > rewind->arena_size) {
+    return false;
+  }
+
+  while (rewind->count > 0) {
+    size_t oldest = chip8_rewind_entry(rewind, 0)->offset;
+
+    if (rewind->count < rewind->capacity) {
+      if (rewind->head >= oldest && rewind->head + size <= rewind->arena_size) {
+        *offset = rewind->head;
+        return true;
+      }
+      if (rewind->head >= oldest && size < oldest) {
+        *offset = 0;
+        return true;
+      }
+      if (rewind->head < oldest && rewind->head + size < oldest) {
+        *offset = rewind->head;
+        return true;
+      }
+    }
+
+    chip8_rewind_evict(rewind);
+  }
+
+  *offset = 0;
+  return true;
+}
+
+/**
+ * @brief Builds the delta record from the previous frame to a state
+ * @param rewind: a pointer to the history
+ * @param state: the state of the new frame
+ * @returns the size of the record
+ */
+static size_t chip8_rewind_delta(CHIP8_REWIND* rewind, const uint8_t* state) {
+  uint32_t rows = 0;
+  uint64_t pages = 0;
+  uint8_t* p = rewind->record + REWIND_MASKS;
+
+  memcpy(p, state, STATE_DISPLAY_OFFSET);
+  p += STATE_DISPLAY_OFFSET;
+
+  for (size_t row = 0; row < DISPLAY_HEIGHT; row++) {
+    size_t at = STATE_DISPLAY_OFFSET + row * 8;
+    if (memcmp(state + at, rewind->last + at, 8) != 0) {
+      rows |= UINT32_C(1) << row;
+      memcpy(p, state + at, 8);
+      p += 8;
+    }
+  }
+
+  for (size_t page = 0; page < REWIND_PAGES; page++) {
+    size_t at = STATE_MEMORY_OFFSET + page * REWIND_PAGE;
+    if (memcmp(state + at, rewind->last + at, REWIND_PAGE) != 0) {
+      pages |= UINT64_C(1) << page;
+      memcpy(p, state + at, REWIND_PAGE);
+      p += REWIND_PAGE;
+    }
+  }
+
+  memcpy(rewind->record, &rows, sizeof(rows));
+  memcpy(rewind->record + sizeof(rows), &pages, sizeof(pages));
+
+  return p - rewind->record;
+}
+
+/**
+ * @brief Applies a delta record on top of the previous frame's state
+ * @param record: the delta record
+ * @param state: the previous frame's state, updated in place
+ * @returns void
+ */
+static void chip8_rewind_apply(const uint8_t* record, uint8_t* state) {
+  uint32_t rows = 0;
+  uint64_t pages = 0;
+  const uint8_t* p = record + REWIND_MASKS;
+
+  memcpy(&rows, record, sizeof(rows));
+  memcpy(&pages, record + sizeof(rows), sizeof(pages));
+
+  memcpy(state, p, STATE_DISPLAY_OFFSET);
+  p += STATE_DISPLAY_OFFSET;
+
+  for (size_t row = 0; row < DISPLAY_HEIGHT; row++) {
+    if ((rows >> row) & 1) {
+      memcpy(state + STATE_DISPLAY_OFFSET + row * 8, p, 8);
+      p += 8;
+    }
+  }
+
+  for (size_t page = 0; page < REWIND_PAGES; page++) {
+    if ((pages >> page) & 1) {
+      memcpy(state + STATE_MEMORY_OFFSET + page * REWIND_PAGE, p, REWIND_PAGE);
+      p += REWIND_PAGE;
+    }
+  }
+}
+
+/**
+ * @brief Records the current frame
+ * @param rewind: a pointer to the history
+ * @param emulator: a pointer to the CHIP-8 emulator
+ * @returns a boolean that indicates whether the frame was recorded
+ */
+bool chip8_rewind_capture(CHIP8_REWIND* rewind, const CHIP8* emulator) {
+  uint8_t state[STATE_SIZE];
+  const uint8_t* record = rewind->record;
+  size_t size = 0;
+  size_t offset = 0;
+  bool keyframe = rewind->count == 0 ||
+                  rewind->since_keyframe + 1 >= REWIND_KEYFRAME_INTERVAL;
+
+  chip8_state_save(emulator, state, sizeof(state));
+
+  if (keyframe == true) {
+    record = state;
+    size = STATE_SIZE;
+  } else {
+    size = chip8_rewind_delta(rewind, state);
+  }
+
+  if (chip8_rewind_reserve(rewind, size, &offset) == false) {
+    return false;
+  }
+
+  // Evicting everything leaves nothing for a delta to build on
+  if (rewind->count == 0 && keyframe == false) {
+    record = state;
+    size = STATE_SIZE;
+    keyframe = true;
+    if (chip8_rewind_reserve(rewind, size, &offset) == false) {
+      return false;
+    }
+  }
+
+  memcpy(rewind->arena + offset, record, size);
+
+  REWIND_ENTRY* entry = chip8_rewind_entry(rewind, rewind->count);
+  entry->offset = offset;
+  entry->size = size;
+  entry->keyframe = keyframe;
+  rewind->count++;
+  rewind->head = offset + size;
+  rewind->since_keyframe = keyframe ? 0 : rewind->since_keyframe + 1;
+  memcpy(rewind->last, state, STATE_SIZE);
+
+  return true;
+}
+
+/**
+ * @brief Steps the emulator back one captured frame
+ * @param rewind: a pointer to the history
+ * @param emulator: a pointer to the CHIP-8 emulator
+ * @returns a boolean that indicates whether there was a frame to go back to
+ *
+ * The newest frame is the present, so it is dropped and the emulator is
+ * restored to the one captured before it.
+ */
+bool chip8_rewind_step(CHIP8_REWIND* rewind, CHIP8* emulator) {
+  if (rewind->count < 2) {
+    return false;
+  }
+
+  rewind->count--;
+  rewind->head = chip8_rewind_entry(rewind, rewind->count)->offset;
+
+  size_t keyframe = rewind->count - 1;
+  while (chip8_rewind_entry(rewind, keyframe)->keyframe == false) {
+    keyframe--;
+  }
+
+  memcpy(rewind->last,
+         rewind->arena + chip8_rewind_entry(rewind, keyframe)->offset,
+         STATE_SIZE);
+  for (size_t i = keyframe + 1; i < rewind->count; i++) {
+    chip8_rewind_apply(rewind->arena + chip8_rewind_entry(rewind, i)->offset,
+                       rewind->last);
+  }
+  rewind->since_keyframe = rewind->count - 1 - keyframe;
+
+  return chip8_state_load(emulator, rewind->last, STATE_SIZE);
+}
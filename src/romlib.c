@@ -0,0 +1,695 @@
+#include <dirent.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "../include/romlib.h"
+
+/*
+ * ROM library
+ *
+ * ROMs are keyed by content hash, which lets settings follow a ROM across
+ * renames and stores duplicates once. An archive is one read-only mapping
+ * whose index is already hashed and sorted, so opening it only copies the
+ * entries into an array and loading a ROM is a single copy. A directory
+ * keeps a persistent index of its own in ROMLIB_INDEX_FILE: opening it
+ * stats every file, but only files whose size or modification time changed
+ * since the index was written are read and hashed. A directory ROM is read
+ * from its file when it is loaded, and checked against its hash.
+ */
+
+#define ROMLIB_INITIAL_ROMS 64
+
+static int chip8_romlib_compare(const void* a, const void* b) {
+  const CHIP8_ROM* first = a;
+  const CHIP8_ROM* second = b;
+
+  if (first->hash != second->hash) {
+    return first->hash < second->hash ? -1 : 1;
+  }
+
+  return strcmp(first->name, second->name);
+}
+
+/*
+ * One line of a directory index. Names read from the file are owned by the
+ * index; names of an index being built point into the library's ROMs.
+ */
+typedef struct {
+    const char *name;
+    uint64_t hash;
+    uint32_t size;
+    struct timespec mtime;
+} CHIP8_ROMLIB_INDEX_ENTRY;
+
+typedef struct {
+    CHIP8_ROMLIB_INDEX_ENTRY *entries;
+    size_t count;
+    size_t capacity;
+} CHIP8_ROMLIB_INDEX;
+
+static int chip8_romlib_compare_index(const void* a, const void* b) {
+  const CHIP8_ROMLIB_INDEX_ENTRY* first = a;
+  const CHIP8_ROMLIB_INDEX_ENTRY* second = b;
+
+  return strcmp(first->name, second->name);
+}
+
+/**
+ * @brief Appends an entry to an index
+ * @param index: a pointer to the index
+ * @param entry: the entry to copy
+ * @returns a boolean that indicates success
+ */
+static bool chip8_romlib_index_add(CHIP8_ROMLIB_INDEX* index,
+                                   const CHIP8_ROMLIB_INDEX_ENTRY* entry) {
+  if (index->count == index->capacity) {
+    size_t capacity =
+        index->capacity > 0 ? index->capacity * 2 : ROMLIB_INITIAL_ROMS;
+    CHIP8_ROMLIB_INDEX_ENTRY* entries =
+        realloc(index->entries, capacity * sizeof(CHIP8_ROMLIB_INDEX_ENTRY));
+    if (entries == NULL) {
+      return false;
+    }
+    index->entries = entries;
+    index->capacity = capacity;
+  }
+
+  index->entries[index->count++] = *entry;
+
+  return true;
+}
+
+/**
+ * @brief Reads the index a directory was last opened with
+ * @param directory: the path of the directory
+ * @param index: a pointer to an empty index, sorted by name on return
+ * @returns void
+ *
+ * A missing or unreadable index, or one with another header, is left
+ * empty, so every file is hashed again.
+ */
+static void chip8_romlib_read_index(const char* directory,
+                                    CHIP8_ROMLIB_INDEX* index) {
+  char path[PATH_MAX];
+  char line[PATH_MAX + 128];
+
+  snprintf(path, sizeof(path), "%s/%s", directory, ROMLIB_INDEX_FILE);
+  FILE* fp = fopen(path, "r");
+  if (fp == NULL) {
+    return;
+  }
+
+  if (fgets(line, sizeof(line), fp) == NULL ||
+      strcmp(line, ROMLIB_INDEX_HEADER) != 0) {
+    fclose(fp);
+    return;
+  }
+
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    unsigned long long hash = 0;
+    unsigned long size = 0;
+    long long seconds = 0;
+    long nanoseconds = 0;
+    int name = 0;
+
+    // hash size seconds nanoseconds name, the name running to the end
+    line[strcspn(line, "\n")] = '\0';
+    if (sscanf(line, "%llx %lu %lld %ld %n", &hash, &size, &seconds,
+               &nanoseconds, &name) != 4 ||
+        line[name] == '\0') {
+      continue;
+    }
+
+    size_t length = strlen(line + name) + 1;
+    char* copy = malloc(length);
+    if (copy == NULL) {
+      break;
+    }
+    memcpy(copy, line + name, length);
+
+    CHIP8_ROMLIB_INDEX_ENTRY entry = {
+        .name = copy,
+        .hash = hash,
+        .size = size,
+        .mtime = {.tv_sec = seconds, .tv_nsec = nanoseconds},
+    };
+    if (chip8_romlib_index_add(index, &entry) == false) {
+      free(copy);
+      break;
+    }
+  }
+
+  fclose(fp);
+  qsort(index->entries, index->count, sizeof(CHIP8_ROMLIB_INDEX_ENTRY),
+        chip8_romlib_compare_index);
+}
+
+/**
+ * @brief Replaces the index of a directory
+ * @param directory: the path of the directory
+ * @param index: a pointer to the index of every ROM just opened
+ * @returns void
+ *
+ * The index is written to a temporary file and renamed over the old one,
+ * so a reader never sees half of it. A directory that cannot be written
+ * keeps its old index, and is hashed again on the next open.
+ */
+static void chip8_romlib_write_index(const char* directory,
+                                     const CHIP8_ROMLIB_INDEX* index) {
+  char path[PATH_MAX];
+  char temporary[PATH_MAX];
+
+  snprintf(path, sizeof(path), "%s/%s", directory, ROMLIB_INDEX_FILE);
+  if (snprintf(temporary, sizeof(temporary), "%s.tmp", path) >=
+      (int)sizeof(temporary)) {
+    return;
+  }
+
+  FILE* fp = fopen(temporary, "w");
+  if (fp == NULL) {
+    log_async_debug("ROM index could not be written");
+    return;
+  }
+
+  bool success = fputs(ROMLIB_INDEX_HEADER, fp) >= 0;
+  for (size_t i = 0; i < index->count && success == true; i++) {
+    const CHIP8_ROMLIB_INDEX_ENTRY* entry = &index->entries[i];
+    // A name with a line break cannot be stored, so it is always hashed
+    if (strchr(entry->name, '\n') != NULL) {
+      continue;
+    }
+    success = fprintf(fp, "%016llx %lu %lld %ld %s\n",
+                      (unsigned long long)entry->hash,
+                      (unsigned long)entry->size,
+                      (long long)entry->mtime.tv_sec,
+                      (long)entry->mtime.tv_nsec, entry->name) > 0;
+  }
+
+  if (fclose(fp) != 0 || success == false ||
+      rename(temporary, path) != 0) {
+    unlink(temporary);
+  }
+}
+
+/**
+ * @brief Reads a ROM file whole
+ * @param path: the path of the file
+ * @param buffer: room for ROMLIB_ROM_MAX + 1 bytes
+ * @param size: set to the size of the ROM
+ * @returns a boolean that indicates whether the file could be a ROM
+ */
+static bool chip8_romlib_read_file(const char* path, uint8_t* buffer,
+                                   uint32_t* size) {
+  FILE* fp = fopen(path, "rb");
+  if (fp == NULL) {
+    return false;
+  }
+
+  size_t bytes_read = fread(buffer, 1, ROMLIB_ROM_MAX + 1, fp);
+  fclose(fp);
+
+  if (bytes_read == 0 || bytes_read > ROMLIB_ROM_MAX) {
+    return false;
+  }
+  *size = bytes_read;
+
+  return true;
+}
+
+/**
+ * @brief Gets the contents of a ROM
+ * @param rom: a pointer to the ROM
+ * @param buffer: room for ROMLIB_ROM_MAX + 1 bytes, used for a directory ROM
+ * @returns a pointer to the contents, or NULL if the file of a directory ROM
+ * cannot be read or no longer matches its hash
+ */
+static const uint8_t* chip8_romlib_contents(const CHIP8_ROM* rom,
+                                            uint8_t* buffer) {
+  uint32_t size = 0;
+
+  if (rom->data != NULL) {
+    return rom->data;
+  }
+
+  if (chip8_romlib_read_file(rom->path, buffer, &size) == false ||
+      size != rom->size || chip8_hash_bytes(buffer, size) != rom->hash) {
+    log_async_warn("ROM %llX changed since the library was opened",
+                   rom->hash);
+    return NULL;
+  }
+
+  return buffer;
+}
+
+/**
+ * @brief Indexes one file of a directory as a ROM
+ * @param directory: the path of the directory
+ * @param name: the name of the file
+ * @param st: the status of the file
+ * @param cached: the index the directory was last opened with
+ * @param rom: a pointer to the ROM to fill in
+ * @param hashed: set to true if the file had to be read and hashed
+ * @returns a boolean that indicates whether the file is a ROM
+ */
+static bool chip8_romlib_index_file(const char* directory, const char* name,
+                                    const struct stat* st,
+                                    const CHIP8_ROMLIB_INDEX* cached,
+                                    CHIP8_ROM* rom, bool* hashed) {
+  size_t directory_length = strlen(directory);
+  size_t name_length = strlen(name);
+
+  char* path = malloc(directory_length + name_length + 2);
+  if (path == NULL) {
+    return false;
+  }
+  memcpy(path, directory, directory_length);
+  path[directory_length] = '/';
+  memcpy(path + directory_length + 1, name, name_length + 1);
+
+  memset(rom, 0, sizeof(CHIP8_ROM));
+  rom->path = path;
+  rom->name = path + directory_length + 1;
+  rom->size = st->st_size;
+
+  CHIP8_ROMLIB_INDEX_ENTRY key = {.name = name};
+  const CHIP8_ROMLIB_INDEX_ENTRY* entry =
+      cached->count > 0
+          ? bsearch(&key, cached->entries, cached->count,
+                    sizeof(CHIP8_ROMLIB_INDEX_ENTRY),
+                    chip8_romlib_compare_index)
+          : NULL;
+  if (entry != NULL && entry->size == rom->size &&
+      entry->mtime.tv_sec == st->st_mtim.tv_sec &&
+      entry->mtime.tv_nsec == st->st_mtim.tv_nsec) {
+    rom->hash = entry->hash;
+    return true;
+  }
+
+  uint8_t buffer[ROMLIB_ROM_MAX + 1];
+  uint32_t size = 0;
+  if (chip8_romlib_read_file(path, buffer, &size) == false ||
+      size != rom->size) {
+    free(path);
+    return false;
+  }
+
+  rom->hash = chip8_hash_bytes(buffer, size);
+  *hashed = true;
+
+  return true;
+}
+
+/**
+ * @brief Applies the settings file of a directory, if it has one
+ * @param library: a pointer to the library
+ * @param directory: the path of the directory
+ * @returns void
+ *
+ * Lines hold a hexadecimal content hash, the instructions per frame and
+ * the seed. Blank lines, lines starting with # and unknown hashes are
+ * ignored.
+ */
+static void chip8_romlib_read_settings(CHIP8_ROMLIB* library,
+                                       const char* directory) {
+  char path[PATH_MAX];
+  char line[256];
+
+  snprintf(path, sizeof(path), "%s/%s", directory, ROMLIB_SETTINGS_FILE);
+  FILE* fp = fopen(path, "r");
+  if (fp == NULL) {
+    return;
+  }
+
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    unsigned long long hash = 0;
+    unsigned ipf = 0;
+    unsigned long seed = 0;
+
+    if (line[0] == '#' ||
+        sscanf(line, "%llx %u %lu", &hash, &ipf, &seed) != 3) {
+      continue;
+    }
+
+    CHIP8_ROM* rom = (CHIP8_ROM*)chip8_romlib_find(library, hash);
+    CHIP8_ROM* end = library->roms + library->count;
+    for (; rom != NULL && rom < end && rom->hash == hash; rom++) {
+      rom->settings.instructions_per_frame = ipf;
+      rom->settings.seed = seed;
+    }
+  }
+
+  fclose(fp);
+}
+
+/**
+ * @brief Indexes every ROM in a directory
+ * @param library: a pointer to the empty library
+ * @param path: the path of the directory
+ * @returns a boolean that indicates success
+ *
+ * Hidden files, the settings file and files too large to be a ROM are
+ * skipped. Hashes come from the directory's index when a file's size and
+ * modification time match it, and the index is rewritten when anything
+ * changed.
+ */
+static bool chip8_romlib_open_directory(CHIP8_ROMLIB* library,
+                                        const char* path) {
+  CHIP8_ROMLIB_INDEX cached = {0};
+  CHIP8_ROMLIB_INDEX fresh = {0};
+  size_t capacity = 0;
+  bool hashed = false;
+  bool success = true;
+
+  DIR* directory = opendir(path);
+  if (directory == NULL) {
+    return false;
+  }
+
+  chip8_romlib_read_index(path, &cached);
+
+  for (struct dirent* entry = readdir(directory);
+       entry != NULL && success == true; entry = readdir(directory)) {
+    struct stat st;
+
+    if (entry->d_name[0] == '.' ||
+        strcmp(entry->d_name, ROMLIB_SETTINGS_FILE) == 0 ||
+        fstatat(dirfd(directory), entry->d_name, &st, 0) != 0 ||
+        S_ISREG(st.st_mode) == false || st.st_size == 0 ||
+        st.st_size > ROMLIB_ROM_MAX) {
+      continue;
+    }
+
+    if (library->count == capacity) {
+      capacity = capacity > 0 ? capacity * 2 : ROMLIB_INITIAL_ROMS;
+      CHIP8_ROM* roms = realloc(library->roms, capacity * sizeof(CHIP8_ROM));
+      if (roms == NULL) {
+        success = false;
+        break;
+      }
+      library->roms = roms;
+    }
+
+    CHIP8_ROM* rom = &library->roms[library->count];
+    if (chip8_romlib_index_file(path, entry->d_name, &st, &cached, rom,
+                                &hashed) == false) {
+      continue;
+    }
+    library->count++;
+
+    CHIP8_ROMLIB_INDEX_ENTRY line = {
+        .name = rom->name,
+        .hash = rom->hash,
+        .size = rom->size,
+        .mtime = st.st_mtim,
+    };
+    success = chip8_romlib_index_add(&fresh, &line);
+  }
+
+  closedir(directory);
+
+  // New, changed and removed files all make the old index stale
+  if (success == true && (hashed == true || fresh.count != cached.count)) {
+    chip8_romlib_write_index(path, &fresh);
+  }
+
+  for (size_t i = 0; i < cached.count; i++) {
+    free((void*)cached.entries[i].name);
+  }
+  free(cached.entries);
+  free(fresh.entries);
+
+  if (success == false) {
+    return false;
+  }
+
+  qsort(library->roms, library->count, sizeof(CHIP8_ROM),
+        chip8_romlib_compare);
+  chip8_romlib_read_settings(library, path);
+
+  return true;
+}
+
+/**
+ * @brief Maps an archive written by chip8_romlib_pack()
+ * @param library: a pointer to the empty library
+ * @param fd: the open archive
+ * @param size: the size of the archive in bytes
+ * @returns a boolean that indicates whether the archive is well formed
+ */
+static bool chip8_romlib_open_archive(CHIP8_ROMLIB* library, int fd,
+                                      size_t size) {
+  if (size < ROMLIB_HEADER_SIZE) {
+    return false;
+  }
+
+  void* archive = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (archive == MAP_FAILED) {
+    return false;
+  }
+  library->archive = archive;
+  library->archive_size = size;
+
+  const uint8_t* bytes = archive;
+  uint32_t count = state_get32(bytes + 8);
+  if (memcmp(bytes, ROMLIB_MAGIC, 4) != 0 ||
+      state_get16(bytes + 4) != ROMLIB_VERSION ||
+      count > (size - ROMLIB_HEADER_SIZE) / ROMLIB_ENTRY_SIZE) {
+    return false;
+  }
+
+  library->roms = calloc(count > 0 ? count : 1, sizeof(CHIP8_ROM));
+  if (library->roms == NULL) {
+    return false;
+  }
+
+  for (; library->count < count; library->count++) {
+    const uint8_t* entry =
+        bytes + ROMLIB_HEADER_SIZE + library->count * ROMLIB_ENTRY_SIZE;
+    CHIP8_ROM* rom = &library->roms[library->count];
+    uint32_t offset = state_get32(entry + 8);
+
+    rom->hash = state_get64(entry);
+    rom->size = state_get32(entry + 12);
+    rom->settings.instructions_per_frame = state_get16(entry + 16);
+    rom->settings.seed = state_get32(entry + 20);
+    rom->name = (const char*)entry + 24;
+    rom->data = bytes + offset;
+
+    // ROMs must fit inside the archive, names must be terminated and the
+    // index must stay sorted
+    if (rom->size == 0 || rom->size > ROMLIB_ROM_MAX || offset > size ||
+        rom->size > size - offset || entry[24 + ROMLIB_NAME_SIZE - 1] != 0 ||
+        (library->count > 0 && rom->hash < rom[-1].hash)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @brief Opens a directory of ROMs or a ROM archive
+ * @param path: the path of the directory or archive
+ * @returns a pointer to the library, or NULL if it could not be opened or
+ * the archive is malformed
+ */
+CHIP8_ROMLIB* chip8_romlib_open(const char* path) {
+  struct stat st;
+
+  CHIP8_ROMLIB* library = calloc(1, sizeof(CHIP8_ROMLIB));
+  if (library == NULL) {
+    return NULL;
+  }
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    goto fail;
+  }
+
+  bool success = false;
+  if (S_ISDIR(st.st_mode)) {
+    success = chip8_romlib_open_directory(library, path);
+  } else if (S_ISREG(st.st_mode)) {
+    success = chip8_romlib_open_archive(library, fd, st.st_size);
+  }
+
+  if (success == false) {
+    goto fail;
+  }
+
+  close(fd);
+  log_async_info("Opened %llu ROMs", library->count);
+
+  return library;
+
+fail:
+  if (fd >= 0) {
+    close(fd);
+  }
+  chip8_romlib_close(library);
+
+  return NULL;
+}
+
+/**
+ * @brief Unmaps or frees every ROM and frees a library
+ * @param library: a pointer to the library, or NULL
+ * @returns void
+ */
+void chip8_romlib_close(CHIP8_ROMLIB* library) {
+  if (library == NULL) {
+    return;
+  }
+
+  if (library->archive != NULL) {
+    munmap(library->archive, library->archive_size);
+  } else {
+    for (size_t i = 0; i < library->count; i++) {
+      free((void*)library->roms[i].path);
+    }
+  }
+
+  free(library->roms);
+  free(library);
+}
+
+/**
+ * @brief Finds a ROM by content hash
+ * @param library: a pointer to the library
+ * @param hash: the FNV-1a hash of the contents, see chip8_hash_bytes()
+ * @returns a pointer to the first name with that hash, or NULL if the
+ * library does not have it
+ */
+const CHIP8_ROM* chip8_romlib_find(const CHIP8_ROMLIB* library,
+                                   uint64_t hash) {
+  size_t low = 0;
+  size_t high = library->count;
+
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (library->roms[middle].hash < hash) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  if (low < library->count && library->roms[low].hash == hash) {
+    return &library->roms[low];
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Finds a ROM by name or by its hash written in hexadecimal
+ * @param library: a pointer to the library
+ * @param key: the name or the 16-digit hash
+ * @returns a pointer to the ROM, or NULL if the library does not have it
+ */
+const CHIP8_ROM* chip8_romlib_lookup(const CHIP8_ROMLIB* library,
+                                     const char* key) {
+  for (size_t i = 0; i < library->count; i++) {
+    if (strcmp(library->roms[i].name, key) == 0) {
+      return &library->roms[i];
+    }
+  }
+
+  char* end = NULL;
+  unsigned long long hash = strtoull(key, &end, 16);
+  if (strlen(key) == 16 && *end == '\0') {
+    return chip8_romlib_find(library, hash);
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Writes a library with its settings to an archive
+ * @param library: a pointer to the library
+ * @param path: the name of the archive to write
+ * @returns a boolean that indicates success
+ *
+ * Names longer than ROMLIB_NAME_SIZE - 1 bytes are cut, with a warning.
+ */
+bool chip8_romlib_pack(const CHIP8_ROMLIB* library, const char* path) {
+  uint8_t header[ROMLIB_HEADER_SIZE] = {0};
+  uint32_t offset =
+      ROMLIB_HEADER_SIZE + library->count * ROMLIB_ENTRY_SIZE;
+
+  memcpy(header, ROMLIB_MAGIC, 4);
+  state_put16(header + 4, ROMLIB_VERSION);
+  state_put32(header + 8, library->count);
+
+  FILE* fp = fopen(path, "wb");
+  if (fp == NULL) {
+    return false;
+  }
+
+  bool success = fwrite(header, 1, sizeof(header), fp) == sizeof(header);
+  for (size_t i = 0; i < library->count && success == true; i++) {
+    const CHIP8_ROM* rom = &library->roms[i];
+    uint8_t entry[ROMLIB_ENTRY_SIZE] = {0};
+
+    state_put64(entry, rom->hash);
+    state_put32(entry + 8, offset);
+    state_put32(entry + 12, rom->size);
+    state_put16(entry + 16, rom->settings.instructions_per_frame);
+    state_put32(entry + 20, rom->settings.seed);
+    size_t length = strlen(rom->name);
+    if (length >= ROMLIB_NAME_SIZE) {
+      log_async_warn("Name of ROM %llX is cut to %llu bytes in the archive",
+                     rom->hash, ROMLIB_NAME_SIZE - 1);
+      length = ROMLIB_NAME_SIZE - 1;
+    }
+    memcpy(entry + 24, rom->name, length);
+    if (i + 1 < library->count && rom[1].hash != rom->hash) {
+      offset += rom->size;
+    }
+
+    success = fwrite(entry, 1, sizeof(entry), fp) == sizeof(entry);
+  }
+
+  // Aliases point at the data of the first name with their hash
+  for (size_t i = 0; i < library->count && success == true; i++) {
+    const CHIP8_ROM* rom = &library->roms[i];
+    if (i == 0 || rom[-1].hash != rom->hash) {
+      uint8_t buffer[ROMLIB_ROM_MAX + 1];
+      const uint8_t* data = chip8_romlib_contents(rom, buffer);
+      success = data != NULL && fwrite(data, 1, rom->size, fp) == rom->size;
+    }
+  }
+
+  return fclose(fp) == 0 && success;
+}
+
+/**
+ * @brief Copies a ROM into the emulator's memory and applies its settings
+ * @param emulator: a pointer to the CHIP-8 emulator at power-on
+ * @param rom: a pointer to the ROM
+ * @returns a boolean indicating success
+ *
+ * A directory ROM is read from its file and must still match its hash; an
+ * archive ROM is copied from the mapping. Both load with chip8_load_bytes().
+ */
+bool chip8_romlib_load(CHIP8* emulator, const CHIP8_ROM* rom) {
+  uint8_t buffer[ROMLIB_ROM_MAX + 1];
+  const uint8_t* data = chip8_romlib_contents(rom, buffer);
+
+  if (data == NULL || chip8_load_bytes(emulator, data, rom->size) == false) {
+    return false;
+  }
+
+  if (rom->settings.instructions_per_frame != 0) {
+    emulator->instructions_per_frame = rom->settings.instructions_per_frame;
+  }
+
+  if (rom->settings.seed != 0) {
+    chip8_seed(emulator, rom->settings.seed);
+  }
+
+  log_async_info("Loaded ROM %llX from the library", rom->hash);
+
+  return true;
+}
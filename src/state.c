@@ -0,0 +1,223 @@
+#include "../include/state.h"
+
+// Size of the memory chunks compared when restoring
+#define STATE_LINE 64
+
+/**
+ * @brief Serializes the machine state into a buffer
+ * @param emulator: a pointer to the CHIP-8 emulator
+ * @param buffer: the buffer to write the state into
+ * @param size: the size of the buffer, at least STATE_SIZE
+ * @returns a boolean that indicates success
+ */
+bool chip8_state_save(const CHIP8* emulator, uint8_t* buffer, size_t size) {
+  uint16_t keys = 0;
+
+  if (size < STATE_SIZE) {
+    return false;
+  }
+
+  memset(buffer, 0, STATE_DISPLAY_OFFSET);
+  memcpy(buffer, STATE_MAGIC, 4);
+  state_put16(buffer + 4, STATE_VERSION);
+  memcpy(buffer + 8, emulator->V, V_REGISTERS_SIZE);
+  state_put16(buffer + 24, emulator->I);
+  state_put16(buffer + 26, emulator->PC);
+  buffer[28] = emulator->stack.top + 1;
+  buffer[29] = emulator->delay_timer;
+  buffer[30] = emulator->sound_timer;
+  for (size_t i = 0; i < STACK_SIZE; i++) {
+    state_put16(buffer + 32 + i * 2, emulator->stack.array[i]);
+  }
+  state_put64(buffer + 64, emulator->instructions);
+  state_put64(buffer + 72, emulator->frames);
+  for (size_t i = 0; i < KEYPAD_SIZE; i++) {
+    keys |= emulator->keypad[i] << i;
+  }
+  state_put16(buffer + 80, keys);
+  state_put32(buffer + 84, emulator->random);
+
+  for (size_t row = 0; row < DISPLAY_HEIGHT; row++) {
+    state_put64(buffer + STATE_DISPLAY_OFFSET + row * 8, emulator->display[row]);
+  }
+  memcpy(buffer + STATE_MEMORY_OFFSET, emulator->memory, MEMORY_SIZE);
+
+  return true;
+}
+
+/**
+ * @brief Restores machine state from a buffer in place
+ * @param emulator: a pointer to the CHIP-8 emulator
+ * @param buffer: the buffer written by chip8_state_save
+ * @param size: the size of the buffer
+ * @returns a boolean that indicates success, the emulator is untouched on
+ * failure
+ *
+ * Only the bytes that differ from the current memory are copied and
+ * invalidated, so predecoded and compiled code for the rest survives even
+ * when it shares a line with changed data.
+ */
+bool chip8_state_load(CHIP8* emulator, const uint8_t* buffer, size_t size) {
+  if (size < STATE_SIZE || memcmp(buffer, STATE_MAGIC, 4) != 0) {
+    return false;
+  }
+
+  uint16_t version = state_get16(buffer + 4);
+  if (version == 0 || version > STATE_VERSION || buffer[28] > STACK_SIZE) {
+    return false;
+  }
+
+  memcpy(emulator->V, buffer + 8, V_REGISTERS_SIZE);
+  emulator->I = state_get16(buffer + 24);
+  emulator->PC = state_get16(buffer + 26);
+  emulator->stack.top = (size_t)buffer[28] - 1;
+  emulator->delay_timer = buffer[29];
+  emulator->sound_timer = buffer[30];
+  for (size_t i = 0; i < STACK_SIZE; i++) {
+    emulator->stack.array[i] = state_get16(buffer + 32 + i * 2);
+  }
+  emulator->instructions = state_get64(buffer + 64);
+  emulator->frames = state_get64(buffer + 72);
+  uint16_t keys = state_get16(buffer + 80);
+  for (size_t i = 0; i < KEYPAD_SIZE; i++) {
+    emulator->keypad[i] = (keys >> i) & 1;
+  }
+  // Version 1 has no generator state, so the current one carries on
+  if (version >= 2 && state_get32(buffer + 84) != 0) {
+    emulator->random = state_get32(buffer + 84);
+  }
+
+  for (size_t row = 0; row < DISPLAY_HEIGHT; row++) {
+    uint64_t pixels = state_get64(buffer + STATE_DISPLAY_OFFSET + row * 8);
+    if (emulator->display[row] != pixels) {
+      emulator->display[row] = pixels;
+      emulator->dirty_rows |= UINT32_C(1) << row;
+    }
+  }
+
+  for (uint16_t line = 0; line < MEMORY_SIZE; line += STATE_LINE) {
+    const uint8_t* saved = buffer + STATE_MEMORY_OFFSET + line;
+    uint8_t* current = emulator->memory + line;
+    if (memcmp(current, saved, STATE_LINE) != 0) {
+      uint16_t first = 0;
+      uint16_t last = STATE_LINE - 1;
+      while (current[first] == saved[first]) {
+        first++;
+      }
+      while (current[last] == saved[last]) {
+        last--;
+      }
+
+      memcpy(current + first, saved + first, last - first + 1);
+      chip8_invalidate(emulator, line + first, last - first + 1);
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @brief Writes a save state to a file
+ * @param emulator: a pointer to the CHIP-8 emulator
+ * @param file_name: the name of the file to write
+ * @returns a boolean that indicates success
+ */
+bool chip8_state_save_file(const CHIP8* emulator, const char* file_name) {
+  uint8_t buffer[STATE_SIZE];
+
+  chip8_state_save(emulator, buffer, sizeof(buffer));
+
+  FILE* fp = fopen(file_name, "wb");
+  if (fp == NULL) {
+    return false;
+  }
+
+  size_t written = fwrite(buffer, 1, sizeof(buffer), fp);
+
+  return fclose(fp) == 0 && written == sizeof(buffer);
+}
+
+/**
+ * @brief Restores a save state from a file
+ * @param emulator: a pointer to the CHIP-8 emulator
+ * @param file_name: the name of the file to read
+ * @returns a boolean that indicates success
+ */
+bool chip8_state_load_file(CHIP8* emulator, const char* file_name) {
+  uint8_t buffer[STATE_SIZE];
+
+  FILE* fp = fopen(file_name, "rb");
+  if (fp == NULL) {
+    return false;
+  }
+
+  size_t bytes_read = fread(buffer, 1, sizeof(buffer), fp);
+  fclose(fp);
+
+  return chip8_state_load(emulator, buffer, bytes_read);
+}
+
+/**
+ * @brief Hashes a block of bytes
+ * @param data: the bytes to hash
+ * @param size: the number of bytes
+ * @returns the 64-bit FNV-1a hash
+ */
+uint64_t chip8_hash_bytes(const uint8_t* data, size_t size) {
+  uint64_t hash = UINT64_C(0xCBF29CE484222325);
+
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ data[i]) * UINT64_C(0x100000001B3);
+  }
+
+  return hash;
+}
+
+/**
+ * @brief Hashes the whole machine state
+ * @param emulator: a pointer to the CHIP-8 emulator
+ * @returns the 64-bit FNV-1a hash of the emulator's save state
+ *
+ * Two runs that end with the same hash are in the same state, so replays
+ * and regression runs can be checked with a single number.
+ */
+uint64_t chip8_state_hash(const CHIP8* emulator) {
+  uint8_t buffer[STATE_SIZE];
+
+  chip8_state_save(emulator, buffer, sizeof(buffer));
+
+  return chip8_hash_bytes(buffer, sizeof(buffer));
+}
+
+/**
+ * @brief Runs frames ahead of the present and rolls back
+ * @param emulator: a pointer to the CHIP-8 emulator
+ * @param frames: the number of frames to run ahead
+ * @param future: filled in with the display after those frames
+ * @returns a boolean that indicates whether the frames ran without failure
+ *
+ * The future frame sees the current keypad as if it stayed held. The
+ * emulator ends in the state it started in, with dirty_rows clear because
+ * the caller presents the future frame instead of the present one.
+ */
+bool chip8_run_ahead(CHIP8* emulator, uint32_t frames,
+                     uint64_t future[DISPLAY_HEIGHT]) {
+  uint8_t present[STATE_SIZE];
+  bool success = true;
+  // Frames that are thrown away stay out of the profile
+  struct CHIP8_PROFILE* profile = emulator->profile;
+
+  chip8_state_save(emulator, present, sizeof(present));
+  emulator->profile = NULL;
+
+  for (uint32_t frame = 0; frame < frames && success == true; frame++) {
+    success = chip8_run_frame(emulator);
+  }
+  memcpy(future, emulator->display, sizeof(emulator->display));
+
+  chip8_state_load(emulator, present, sizeof(present));
+  emulator->dirty_rows = 0;
+  emulator->profile = profile;
+
+  return success;
+}
@@ -0,0 +1,190 @@
+#include <stdatomic.h>
+#include <time.h>
+#include "../include/opcodes.h"
+#include "../include/stats.h"
+
+/*
+ * Counters are process-wide and updated with relaxed atomics, so any number
+ * of emulator threads can report into them while another thread dumps.
+ */
+
+typedef struct {
+    atomic_uint_fast64_t count;
+    atomic_uint_fast64_t samples;
+    atomic_uint_fast64_t total_ns;
+    atomic_uint_fast64_t buckets[STATS_BUCKETS];
+} STATS_HISTOGRAM;
+
+static STATS_HISTOGRAM opcode_stats[OP_COUNT];
+static STATS_HISTOGRAM phase_stats[PHASE_COUNT];
+
+static const char* const phase_names[PHASE_COUNT] = {
+    [PHASE_EXECUTE] = "execute",
+    [PHASE_DRAW] = "draw",
+    [PHASE_PRESENT] = "present",
+    [PHASE_EVENTS] = "events",
+};
+
+/**
+ * @brief Reads the monotonic clock
+ * @param void
+ * @returns the time in nanoseconds, never 0
+ */
+uint64_t chip8_stats_now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec + 1;
+}
+
+static void chip8_stats_record(STATS_HISTOGRAM* histogram, uint64_t ns) {
+  size_t bucket = 0;
+
+  while (bucket < STATS_BUCKETS - 1 && ns >= (UINT64_C(1) << bucket)) {
+    bucket++;
+  }
+
+  atomic_fetch_add_explicit(&histogram->samples, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&histogram->total_ns, ns, memory_order_relaxed);
+  atomic_fetch_add_explicit(&histogram->buckets[bucket], 1,
+                            memory_order_relaxed);
+}
+
+/**
+ * @brief Counts an execution and decides whether to time it
+ * @param kind: the opcode form about to run
+ * @returns the start time if this execution is sampled, otherwise 0
+ */
+uint64_t chip8_stats_opcode_begin(uint8_t kind) {
+  uint64_t count = atomic_fetch_add_explicit(&opcode_stats[kind].count, 1,
+                                             memory_order_relaxed);
+
+  return count % STATS_SAMPLE_INTERVAL == 0 ? chip8_stats_now() : 0;
+}
+
+/**
+ * @brief Records how long a sampled execution took
+ * @param kind: the opcode form that ran
+ * @param start: the value chip8_stats_opcode_begin returned
+ * @returns void
+ */
+void chip8_stats_opcode_end(uint8_t kind, uint64_t start) {
+  if (start != 0) {
+    chip8_stats_record(&opcode_stats[kind], chip8_stats_now() - start);
+  }
+}
+
+/**
+ * @brief Records how long a frame phase took
+ * @param phase: the phase that ran
+ * @param start: the value chip8_stats_now returned before it
+ * @returns void
+ */
+void chip8_stats_phase_end(CHIP8_PHASE phase, uint64_t start) {
+  atomic_fetch_add_explicit(&phase_stats[phase].count, 1,
+                            memory_order_relaxed);
+  chip8_stats_record(&phase_stats[phase], chip8_stats_now() - start);
+}
+
+/**
+ * @brief Gets how many times an opcode form ran
+ * @param kind: the opcode form
+ * @returns the execution count
+ */
+uint64_t chip8_stats_count(uint8_t kind) {
+  return atomic_load_explicit(&opcode_stats[kind].count, memory_order_relaxed);
+}
+
+static void chip8_stats_clear(STATS_HISTOGRAM* histogram) {
+  atomic_store_explicit(&histogram->count, 0, memory_order_relaxed);
+  atomic_store_explicit(&histogram->samples, 0, memory_order_relaxed);
+  atomic_store_explicit(&histogram->total_ns, 0, memory_order_relaxed);
+  for (size_t bucket = 0; bucket < STATS_BUCKETS; bucket++) {
+    atomic_store_explicit(&histogram->buckets[bucket], 0,
+                          memory_order_relaxed);
+  }
+}
+
+/**
+ * @brief Clears every counter and histogram
+ * @param void
+ * @returns void
+ */
+void chip8_stats_reset(void) {
+  for (size_t kind = 0; kind < OP_COUNT; kind++) {
+    chip8_stats_clear(&opcode_stats[kind]);
+  }
+
+  for (size_t phase = 0; phase < PHASE_COUNT; phase++) {
+    chip8_stats_clear(&phase_stats[phase]);
+  }
+}
+
+/**
+ * @brief Finds the bucket bound below which a share of the samples fall
+ * @param histogram: the histogram
+ * @param samples: the number of samples in it
+ * @param percent: the share, from 1 to 100
+ * @returns the upper bound of the bucket in nanoseconds
+ */
+static uint64_t chip8_stats_percentile(STATS_HISTOGRAM* histogram,
+                                       uint64_t samples, uint64_t percent) {
+  uint64_t target = (samples * percent + 99) / 100;
+  uint64_t seen = 0;
+
+  for (size_t bucket = 0; bucket < STATS_BUCKETS; bucket++) {
+    seen += atomic_load_explicit(&histogram->buckets[bucket],
+                                 memory_order_relaxed);
+    if (seen >= target) {
+      return UINT64_C(1) << bucket;
+    }
+  }
+
+  return UINT64_C(1) << (STATS_BUCKETS - 1);
+}
+
+static void chip8_stats_dump_row(FILE* fp, const char* name,
+                                 STATS_HISTOGRAM* histogram) {
+  uint64_t count =
+      atomic_load_explicit(&histogram->count, memory_order_relaxed);
+  uint64_t samples =
+      atomic_load_explicit(&histogram->samples, memory_order_relaxed);
+  uint64_t total =
+      atomic_load_explicit(&histogram->total_ns, memory_order_relaxed);
+
+  if (count == 0) {
+    return;
+  }
+
+  fprintf(fp, "%-12s %14llu %10llu %10llu %10llu %10llu\n", name,
+          (unsigned long long)count, (unsigned long long)samples,
+          (unsigned long long)(samples > 0 ? total / samples : 0),
+          (unsigned long long)(samples > 0
+                                   ? chip8_stats_percentile(histogram, samples, 50)
+                                   : 0),
+          (unsigned long long)(samples > 0
+                                   ? chip8_stats_percentile(histogram, samples, 99)
+                                   : 0));
+}
+
+/**
+ * @brief Prints execution counts and latencies per opcode form and phase
+ * @param fp: the stream to print to
+ * @returns void
+ *
+ * Percentiles are upper bounds of power-of-two buckets.
+ */
+void chip8_stats_dump(FILE* fp) {
+  fprintf(fp, "%-12s %14s %10s %10s %10s %10s\n", "opcode", "count",
+          "sampled", "mean ns", "p50 ns", "p99 ns");
+  for (size_t kind = 0; kind < OP_COUNT; kind++) {
+    chip8_stats_dump_row(fp, chip8_opcode_names[kind], &opcode_stats[kind]);
+  }
+
+  fprintf(fp, "%-12s %14s %10s %10s %10s %10s\n", "phase", "count", "sampled",
+          "mean ns", "p50 ns", "p99 ns");
+  for (size_t phase = 0; phase < PHASE_COUNT; phase++) {
+    chip8_stats_dump_row(fp, phase_names[phase], &phase_stats[phase]);
+  }
+}
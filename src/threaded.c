@@ -0,0 +1,257 @@
+#include "../include/threaded.h"
+#include "../include/opcodes.h"
+
+/*
+ * Threaded-code interpreter
+ *
+ * Every entry in emulator->ops carries a dispatch index. Each handler ends
+ * in its own indirect jump to the next handler, so the branch predictor sees
+ * one jump per handler instead of a single shared switch. Compilers without
+ * computed goto get the same code as a switch.
+ */
+
+#if defined(__GNUC__)
+#define THREADED_COMPUTED_GOTO
+// Labels as values are a GNU extension, so -Wpedantic is only silenced
+// around the label table and the indirect jumps
+#define THREADED_EXTENSION_BEGIN \
+  _Pragma("GCC diagnostic push") \
+  _Pragma("GCC diagnostic ignored \"-Wpedantic\"")
+#define THREADED_EXTENSION_END _Pragma("GCC diagnostic pop")
+#endif
+
+/**
+ * @brief Picks the superinstruction for two adjacent instructions, if any
+ * @param first: the decoded instruction
+ * @param second: the decoded instruction that follows it
+ * @returns the dispatch index for the first instruction
+ */
+static uint8_t chip8_threaded_fuse(const CHIP8_OP* first,
+                                   const CHIP8_OP* second) {
+  if (first->kind == OP_LD_BYTE && second->kind == OP_LD_BYTE) {
+    return FUSED_LD_LD;
+  }
+
+  if (first->kind == OP_ADD_BYTE && second->kind == OP_SE_BYTE) {
+    return FUSED_ADD_SE;
+  }
+
+  if (first->kind == OP_LD_I && second->kind == OP_DRW) {
+    return FUSED_LD_I_DRW;
+  }
+
+  return first->kind;
+}
+
+/**
+ * @brief Decodes an address and the one after it, fusing them if possible
+ * @param emulator: a pointer to the CHIP-8 emulator
+ * @param address: the address to decode
+ * @returns a pointer to the decoded instruction
+ */
+static CHIP8_OP* chip8_threaded_decode(CHIP8* emulator, uint16_t address) {
+  uint16_t next_address = (address + 2) & 0xFFF;
+  CHIP8_OP* op = &emulator->ops[address];
+  CHIP8_OP* next = &emulator->ops[next_address];
+
+  chip8_decode(emulator->memory[address] << 8 |
+                   emulator->memory[(address + 1) & 0xFFF],
+               op);
+
+  if (next->handler == NULL) {
+    chip8_decode(emulator->memory[next_address] << 8 |
+                     emulator->memory[(next_address + 1) & 0xFFF],
+                 next);
+  }
+
+  op->dispatch = chip8_threaded_fuse(op, next);
+
+  return op;
+}
+
+/**
+ * @brief Executes instructions with threaded dispatch and superinstructions
+ * @param emulator: a pointer to the CHIP-8 emulator
+ * @param count: the number of instructions to execute
+ * @returns a boolean that indicates success
+ *
+ * A superinstruction counts as two instructions and is only taken when at
+ * least two remain, so the machine state matches the other backends after
+ * any instruction count.
+ */
+bool chip8_execute_threaded(CHIP8* emulator, uint32_t count) {
+  uint32_t remaining = count;
+  bool success = true;
+  CHIP8_OP* op = NULL;
+  CHIP8_OP* second = NULL;
+
+#ifdef THREADED_COMPUTED_GOTO
+  THREADED_EXTENSION_BEGIN
+  static const void* const targets[DISPATCH_COUNT] = {
+      [OP_CLS] = &&TARGET_OP_CLS,
+      [OP_RET] = &&TARGET_OP_RET,
+      [OP_SYS] = &&TARGET_OP_SYS,
+      [OP_JP] = &&TARGET_OP_JP,
+      [OP_CALL] = &&TARGET_OP_CALL,
+      [OP_SE_BYTE] = &&TARGET_OP_SE_BYTE,
+      [OP_SNE_BYTE] = &&TARGET_OP_SNE_BYTE,
+      [OP_SE_REG] = &&TARGET_OP_SE_REG,
+      [OP_LD_BYTE] = &&TARGET_OP_LD_BYTE,
+      [OP_ADD_BYTE] = &&TARGET_OP_ADD_BYTE,
+      [OP_LD_REG] = &&TARGET_OP_LD_REG,
+      [OP_OR] = &&TARGET_OP_OR,
+      [OP_AND] = &&TARGET_OP_AND,
+      [OP_XOR] = &&TARGET_OP_XOR,
+      [OP_ADD_REG] = &&TARGET_OP_ADD_REG,
+      [OP_SUB] = &&TARGET_OP_SUB,
+      [OP_SHR] = &&TARGET_OP_SHR,
+      [OP_SUBN] = &&TARGET_OP_SUBN,
+      [OP_SHL] = &&TARGET_OP_SHL,
+      [OP_SNE_REG] = &&TARGET_OP_SNE_REG,
+      [OP_LD_I] = &&TARGET_OP_LD_I,
+      [OP_JP_V0] = &&TARGET_OP_JP_V0,
+      [OP_RND] = &&TARGET_OP_RND,
+      [OP_DRW] = &&TARGET_OP_DRW,
+      [OP_SKP] = &&TARGET_OP_SKP,
+      [OP_SKNP] = &&TARGET_OP_SKNP,
+      [OP_LD_VX_DT] = &&TARGET_OP_LD_VX_DT,
+      [OP_LD_VX_K] = &&TARGET_OP_LD_VX_K,
+      [OP_LD_DT_VX] = &&TARGET_OP_LD_DT_VX,
+      [OP_LD_ST_VX] = &&TARGET_OP_LD_ST_VX,
+      [OP_ADD_I_VX] = &&TARGET_OP_ADD_I_VX,
+      [OP_LD_F_VX] = &&TARGET_OP_LD_F_VX,
+      [OP_LD_B_VX] = &&TARGET_OP_LD_B_VX,
+      [OP_LD_I_VX] = &&TARGET_OP_LD_I_VX,
+      [OP_LD_VX_I] = &&TARGET_OP_LD_VX_I,
+      [OP_INVALID] = &&TARGET_OP_INVALID,
+      [FUSED_LD_LD] = &&TARGET_FUSED_LD_LD,
+      [FUSED_ADD_SE] = &&TARGET_FUSED_ADD_SE,
+      [FUSED_LD_I_DRW] = &&TARGET_FUSED_LD_I_DRW,
+      [DISPATCH_DECODE] = &&TARGET_DISPATCH_DECODE,
+  };
+  THREADED_EXTENSION_END
+#define TARGET(name) TARGET_##name:
+#define DISPATCH_TO(index)   \
+  do {                       \
+    THREADED_EXTENSION_BEGIN \
+    goto *targets[(index)];  \
+    THREADED_EXTENSION_END   \
+  } while (0)
+#else
+  uint8_t index = 0;
+#define TARGET(name) case name:
+#define DISPATCH_TO(target) \
+  do {                      \
+    index = (target);       \
+    goto dispatch;          \
+  } while (0)
+#endif
+
+#define NEXT()                                 \
+  do {                                         \
+    if (remaining == 0) {                      \
+      goto done;                               \
+    }                                          \
+    op = &emulator->ops[emulator->PC & 0xFFF]; \
+    DISPATCH_TO(op->dispatch);                 \
+  } while (0)
+
+#define STEP(body)                   \
+  remaining--;                       \
+  emulator->PC += 2;                 \
+  if (body(emulator, op) == false) { \
+    goto fail;                       \
+  }                                  \
+  NEXT()
+
+// Superinstructions fall back to their first half near the end of a budget
+#define FUSED_ENTRY()                                  \
+  if (remaining < 2) {                                 \
+    DISPATCH_TO(op->kind);                             \
+  }                                                    \
+  second = &emulator->ops[(emulator->PC + 2) & 0xFFF]; \
+  remaining -= 2;                                      \
+  emulator->PC += 4
+
+  NEXT();
+
+#ifndef THREADED_COMPUTED_GOTO
+dispatch:
+  switch (index) {
+#endif
+    TARGET(OP_CLS) STEP(chip8_op_cls);
+    TARGET(OP_RET) STEP(chip8_op_ret);
+    TARGET(OP_SYS) STEP(chip8_op_sys);
+    TARGET(OP_JP) STEP(chip8_op_jp);
+    TARGET(OP_CALL) STEP(chip8_op_call);
+    TARGET(OP_SE_BYTE) STEP(chip8_op_se_byte);
+    TARGET(OP_SNE_BYTE) STEP(chip8_op_sne_byte);
+    TARGET(OP_SE_REG) STEP(chip8_op_se_reg);
+    TARGET(OP_LD_BYTE) STEP(chip8_op_ld_byte);
+    TARGET(OP_ADD_BYTE) STEP(chip8_op_add_byte);
+    TARGET(OP_LD_REG) STEP(chip8_op_ld_reg);
+    TARGET(OP_OR) STEP(chip8_op_or);
+    TARGET(OP_AND) STEP(chip8_op_and);
+    TARGET(OP_XOR) STEP(chip8_op_xor);
+    TARGET(OP_ADD_REG) STEP(chip8_op_add_reg);
+    TARGET(OP_SUB) STEP(chip8_op_sub);
+    TARGET(OP_SHR) STEP(chip8_op_shr);
+    TARGET(OP_SUBN) STEP(chip8_op_subn);
+    TARGET(OP_SHL) STEP(chip8_op_shl);
+    TARGET(OP_SNE_REG) STEP(chip8_op_sne_reg);
+    TARGET(OP_LD_I) STEP(chip8_op_ld_i);
+    TARGET(OP_JP_V0) STEP(chip8_op_jp_v0);
+    TARGET(OP_RND) STEP(chip8_op_rnd);
+    TARGET(OP_DRW) STEP(chip8_op_drw);
+    TARGET(OP_SKP) STEP(chip8_op_skp);
+    TARGET(OP_SKNP) STEP(chip8_op_sknp);
+    TARGET(OP_LD_VX_DT) STEP(chip8_op_ld_vx_dt);
+    TARGET(OP_LD_VX_K) STEP(chip8_op_ld_vx_k);
+    TARGET(OP_LD_DT_VX) STEP(chip8_op_ld_dt_vx);
+    TARGET(OP_LD_ST_VX) STEP(chip8_op_ld_st_vx);
+    TARGET(OP_ADD_I_VX) STEP(chip8_op_add_i_vx);
+    TARGET(OP_LD_F_VX) STEP(chip8_op_ld_f_vx);
+    TARGET(OP_LD_B_VX) STEP(chip8_op_ld_b_vx);
+    TARGET(OP_LD_I_VX) STEP(chip8_op_ld_i_vx);
+    TARGET(OP_LD_VX_I) STEP(chip8_op_ld_vx_i);
+    TARGET(OP_INVALID) STEP(chip8_op_invalid);
+
+    TARGET(FUSED_LD_LD) {
+      FUSED_ENTRY();
+      chip8_op_ld_byte(emulator, op);
+      chip8_op_ld_byte(emulator, second);
+      NEXT();
+    }
+
+    TARGET(FUSED_ADD_SE) {
+      FUSED_ENTRY();
+      chip8_op_add_byte(emulator, op);
+      chip8_op_se_byte(emulator, second);
+      NEXT();
+    }
+
+    TARGET(FUSED_LD_I_DRW) {
+      FUSED_ENTRY();
+      chip8_op_ld_i(emulator, op);
+      chip8_op_drw(emulator, second);
+      NEXT();
+    }
+
+    TARGET(DISPATCH_DECODE) {
+      op = chip8_threaded_decode(emulator, emulator->PC & 0xFFF);
+      DISPATCH_TO(op->dispatch);
+    }
+#ifndef THREADED_COMPUTED_GOTO
+    default:
+      goto fail;
+  }
+#endif
+
+fail:
+  success = false;
+
+done:
+  emulator->instructions += count - remaining;
+
+  return success;
+}
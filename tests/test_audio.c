@@ -0,0 +1,39 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/audio.h"
+
+#define SAMPLES 1024
+
+int main(void) {
+  CHIP8_AUDIO audio = {0};
+  int16_t samples[SAMPLES];
+
+  // A period of four samples, as audio_open() would step it for a device
+  // running at four times the tone.
+  audio.step = UINT32_C(1) << 30;
+  atomic_init(&audio.playing, false);
+
+  // Silent while the sound timer is stopped, without moving the wave.
+  memset(samples, 0xFF, sizeof(samples));
+  audio_fill(&audio, samples, SAMPLES);
+  for (size_t i = 0; i < SAMPLES; i++) {
+    assert(samples[i] == 0);
+  }
+  assert(audio.phase == 0);
+
+  // A square wave while it runs, continuing across buffers.
+  audio_set(&audio, true);
+  audio_fill(&audio, samples, 3);
+  audio_fill(&audio, samples + 3, SAMPLES - 3);
+  for (size_t i = 0; i < SAMPLES; i++) {
+    int16_t expected = (i % 4) < 2 ? AUDIO_AMPLITUDE : -AUDIO_AMPLITUDE;
+    assert(samples[i] == expected);
+  }
+
+  audio_set(&audio, false);
+  audio_fill(&audio, samples, SAMPLES);
+  assert(samples[0] == 0 && samples[SAMPLES - 1] == 0);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,108 @@
+#include <assert.h>
+#include <stdlib.h>
+#include "../include/batch.h"
+
+#define JOBS 40
+
+// Draws a digit picked by V0, then spins
+static const uint8_t draw[] = {
+    0xF0, 0x29,  // 0x200: I = sprite of V0
+    0xD1, 0x15,  // 0x202: draw it at V1, V1
+    0x12, 0x04,  // 0x204: jump 0x204
+};
+
+static const uint8_t invalid[] = {
+    0x70, 0x01,  // 0x200: V0 += 1
+    0xFF, 0xFF,  // 0x202: invalid
+};
+
+static uint8_t digits[JOBS][sizeof(draw) + 2];
+static CHIP8_ROM roms[JOBS];
+static char names[JOBS][32];
+
+static void prepare(CHIP8_BATCH_JOB* jobs) {
+  memset(jobs, 0, JOBS * sizeof(CHIP8_BATCH_JOB));
+  for (size_t i = 0; i < JOBS; i++) {
+    jobs[i].name = names[i];
+    jobs[i].rom = &roms[i];
+  }
+  // A file that does not exist
+  jobs[JOBS - 1].rom = NULL;
+}
+
+static char* run(CHIP8_BATCH_JOB* jobs, unsigned threads, size_t* failed) {
+  CHIP8_BATCH_CONFIG config = {
+      .frames = 30,
+      .cycles = UINT64_MAX,
+      .instructions_per_frame = 200,
+      .backend = BACKEND_CACHED,
+      .threads = threads,
+  };
+  char* text = NULL;
+  size_t size = 0;
+
+  FILE* out = open_memstream(&text, &size);
+  assert(out != NULL);
+  prepare(jobs);
+  *failed = chip8_batch_run(jobs, JOBS, &config, out);
+  assert(fclose(out) == 0);
+
+  return text;
+}
+
+int main(void) {
+  static CHIP8_BATCH_JOB serial[JOBS];
+  static CHIP8_BATCH_JOB parallel[JOBS];
+
+  // Each ROM loads a different digit into V0 first
+  for (size_t i = 0; i < JOBS; i++) {
+    digits[i][0] = 0x60;
+    digits[i][1] = i % 16;
+    memcpy(digits[i] + 2, draw, sizeof(draw));
+    roms[i].data = digits[i];
+    roms[i].size = sizeof(digits[i]);
+    snprintf(names[i], sizeof(names[i]), "rom-%02zu", i);
+  }
+  roms[7].data = invalid;
+  roms[7].size = sizeof(invalid);
+  snprintf(names[JOBS - 1], sizeof(names[0]), "/nonexistent.ch8");
+
+  size_t failed = 0;
+  char* one = run(serial, 1, &failed);
+  assert(failed == 2);
+  char* many = run(parallel, 8, &failed);
+  assert(failed == 2);
+
+  // The same results in the same order however many threads run them,
+  // apart from the times.
+  for (size_t i = 0; i < JOBS; i++) {
+    assert(serial[i].loaded == parallel[i].loaded);
+    assert(serial[i].display_hash == parallel[i].display_hash);
+    assert(serial[i].instructions == parallel[i].instructions);
+  }
+  char* line = many;
+  for (size_t i = 0; i < JOBS; i++) {
+    assert(strncmp(line, names[i], strlen(names[i])) == 0);
+    line = strchr(line, '\n') + 1;
+  }
+  assert(*line == '\0');
+  assert(strncmp(one, "rom-00 display=", 15) == 0);
+
+  // Digits 0 and 16 draw the same, 0 and 1 do not.
+  assert(serial[0].display_hash == serial[16].display_hash);
+  assert(serial[0].display_hash != serial[1].display_hash);
+  assert(serial[0].instructions == 30 * 200 && serial[0].frames == 30);
+
+  // A failing instruction stops the run and is reported.
+  assert(serial[7].failed && serial[7].error_opcode == 0xFFFF);
+  assert(serial[7].error_address == 0x202 && serial[7].instructions == 2);
+  assert(strstr(many, "rom-07 display=") != NULL);
+  assert(strstr(many, "error=FFFF@202") != NULL);
+  assert(serial[JOBS - 1].loaded == false);
+  assert(strstr(many, "/nonexistent.ch8 error=load\n") != NULL);
+
+  free(one);
+  free(many);
+
+  return EXIT_SUCCESS;
+}
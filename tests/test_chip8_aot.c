@@ -0,0 +1,42 @@
+#include <assert.h>
+#include <stdlib.h>
+#include "../include/aot.h"
+
+// Translated from tests/roms/aot.ch8 at build time
+extern const CHIP8_AOT_PROGRAM chip8_aot_program;
+
+int main(void) {
+  const uint32_t chunks[] = {1, 2, 3, 5, 7, 11, 64, 257};
+  CHIP8* reference = chip8_new();
+  CHIP8* emulator = chip8_new();
+  assert(reference != NULL && emulator != NULL);
+
+  reference->backend = BACKEND_SWITCH;
+  memcpy(reference->memory + AOT_ROM_ADDRESS, chip8_aot_program.rom,
+         chip8_aot_program.rom_size);
+  chip8_invalidate(reference, 0, MEMORY_SIZE);
+  assert(chip8_aot_load(emulator, &chip8_aot_program));
+
+  // The ROM rewrites one of its own instructions every pass, so translated
+  // blocks have to step aside for the interpreter.
+  for (size_t step = 0; step < 4000; step++) {
+    uint32_t count = chunks[step % (sizeof(chunks) / sizeof(chunks[0]))];
+    assert(chip8_execute(reference, count));
+    assert(chip8_execute(emulator, count));
+
+    assert(memcmp(reference->V, emulator->V, sizeof(reference->V)) == 0);
+    assert(reference->I == emulator->I);
+    assert(reference->PC == emulator->PC);
+    assert(reference->stack.top == emulator->stack.top);
+    assert(memcmp(reference->memory, emulator->memory,
+                  sizeof(reference->memory)) == 0);
+    assert(memcmp(reference->display, emulator->display,
+                  sizeof(reference->display)) == 0);
+    assert(reference->instructions == emulator->instructions);
+  }
+
+  chip8_destroy(reference);
+  chip8_destroy(emulator);
+
+  return 0;  // Success
+}
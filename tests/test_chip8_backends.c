@@ -0,0 +1,81 @@
+#include <assert.h>
+#include <stdlib.h>
+#include "../include/chip8.h"
+
+static const uint8_t rom[] = {
+    0x60, 0x00,  // 0x200: V0 = 0
+    0x61, 0x00,  // 0x202: V1 = 0
+    0xA2, 0x40,  // 0x204: I = 0x240
+    0xD0, 0x15,  // 0x206: draw 5 rows at V0, V1
+    0x70, 0x08,  // 0x208: V0 += 8
+    0x30, 0x40,  // 0x20A: skip if V0 == 0x40
+    0x12, 0x04,  // 0x20C: jump 0x204
+    0x60, 0x00,  // 0x20E: V0 = 0
+    0x71, 0x06,  // 0x210: V1 += 6
+    0x31, 0x24,  // 0x212: skip if V1 == 0x24
+    0x12, 0x04,  // 0x214: jump 0x204
+    0x22, 0x30,  // 0x216: call 0x230
+    0x00, 0xE0,  // 0x218: clear the screen
+    0x12, 0x00,  // 0x21A: jump 0x200
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00,
+    0x62, 0x05,  // 0x230: V2 = 5
+    0x83, 0x24,  // 0x232: V3 += V2
+    0x84, 0x36,  // 0x234: V4 = V3 >> 1
+    0xA3, 0x00,  // 0x236: I = 0x300
+    0xF3, 0x33,  // 0x238: BCD of V3
+    0xF2, 0x65,  // 0x23A: load V0..V2
+    0x00, 0xEE,  // 0x23C: return
+    0x00, 0x00,
+    0xF0, 0x90, 0x90, 0x90, 0xF0,  // 0x240: sprite
+};
+
+static void assert_same_state(const CHIP8* a, const CHIP8* b) {
+  assert(memcmp(a->V, b->V, sizeof(a->V)) == 0);
+  assert(a->I == b->I);
+  assert(a->PC == b->PC);
+  assert(a->stack.top == b->stack.top);
+  assert(memcmp(a->stack.array, b->stack.array, sizeof(a->stack.array)) == 0);
+  assert(memcmp(a->memory, b->memory, sizeof(a->memory)) == 0);
+  assert(memcmp(a->display, b->display, sizeof(a->display)) == 0);
+  assert(a->delay_timer == b->delay_timer);
+  assert(a->sound_timer == b->sound_timer);
+  assert(a->instructions == b->instructions);
+}
+
+int main(void) {
+  const uint8_t backends[] = {BACKEND_CACHED, BACKEND_THREADED,
+                              BACKEND_JIT};
+  const uint32_t chunks[] = {1, 2, 3, 5, 7, 11, 64, 257};
+
+  for (size_t i = 0; i < sizeof(backends); i++) {
+    CHIP8* reference = chip8_new();
+    CHIP8* emulator = chip8_new();
+    assert(reference != NULL && emulator != NULL);
+    assert(chip8_load_bytes(reference, rom, sizeof(rom)));
+    assert(chip8_load_bytes(emulator, rom, sizeof(rom)));
+    reference->backend = BACKEND_SWITCH;
+    emulator->backend = backends[i];
+
+    // Odd budgets make superinstructions straddle the end of a run.
+    for (size_t step = 0; step < 2000; step++) {
+      uint32_t count = chunks[step % (sizeof(chunks) / sizeof(chunks[0]))];
+      assert(chip8_execute(reference, count));
+      assert(chip8_execute(emulator, count));
+      assert_same_state(reference, emulator);
+    }
+
+    chip8_destroy(reference);
+    chip8_destroy(emulator);
+  }
+
+  // A ROM that does not fit above 0x200 is refused
+  static const uint8_t too_big[MEMORY_SIZE - 0x200 + 1];
+  CHIP8* emulator = chip8_new();
+  assert(emulator != NULL);
+  assert(chip8_load_bytes(emulator, too_big, sizeof(too_big)) == false);
+  chip8_destroy(emulator);
+
+  return 0;  // Success
+}
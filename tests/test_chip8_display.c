@@ -0,0 +1,64 @@
+#include <assert.h>
+#include <stdlib.h>
+#include "../include/chip8.h"
+
+static void draw(CHIP8* emulator, uint8_t x, uint8_t y, uint8_t n) {
+  emulator->V[0] = x;
+  emulator->V[1] = y;
+  emulator->memory[0x200] = 0xD0;
+  emulator->memory[0x201] = 0x10 | n;
+  emulator->PC = 0x200;
+  chip8_invalidate(emulator, 0x200, 2);
+  assert(chip8_execute(emulator, 1));
+}
+
+int main(void) {
+  CHIP8* emulator = chip8_new();
+  assert(emulator != NULL);
+  assert(sizeof(emulator->display) == 256);
+
+  emulator->I = 0x300;
+  emulator->memory[0x300] = 0xFF;
+  emulator->memory[0x301] = 0x81;
+
+  // Column 0 is the top bit of a row.
+  draw(emulator, 0, 0, 1);
+  assert(emulator->display[0] == 0xFF00000000000000);
+  assert(emulator->V[0xF] == 0);
+  assert(emulator->dirty_rows == 0x1);
+
+  // Drawing the same sprite again erases it and reports a collision.
+  draw(emulator, 0, 0, 1);
+  assert(emulator->display[0] == 0);
+  assert(emulator->V[0xF] == 1);
+
+  // Sprites are clipped at the right and bottom edges.
+  emulator->dirty_rows = 0;
+  draw(emulator, 60, 31, 2);
+  assert(emulator->dirty_rows == UINT32_C(1) << 31);
+  assert(emulator->display[31] == 0xF);
+  assert(emulator->V[0xF] == 0);
+  for (size_t row = 0; row < 31; row++) {
+    assert(emulator->display[row] == 0);
+  }
+
+  // The start position wraps around the screen.
+  draw(emulator, 64 + 8, 32 + 2, 2);
+  assert(emulator->display[2] == 0x00FF000000000000);
+  assert(emulator->display[3] == 0x0081000000000000);
+
+  // Clearing the screen empties every row.
+  emulator->memory[0x200] = 0x00;
+  emulator->memory[0x201] = 0xE0;
+  emulator->PC = 0x200;
+  chip8_invalidate(emulator, 0x200, 2);
+  assert(chip8_execute(emulator, 1));
+  assert(emulator->dirty_rows == UINT32_MAX);
+  for (size_t row = 0; row < DISPLAY_HEIGHT; row++) {
+    assert(emulator->display[row] == 0);
+  }
+
+  chip8_destroy(emulator);
+
+  return 0;  // Success
+}
@@ -0,0 +1,39 @@
+#include <assert.h>
+#include <stdlib.h>
+#include "../include/chip8.h"
+
+int main(void) {
+  CHIP8* emulator = chip8_new();
+  const uint8_t rom[] = {
+      0x22, 0x10,  // 0x200: call 0x210, decoding it while it is still 6099
+      0x60, 0x12,  // 0x202: V0 = 0x12
+      0x61, 0x34,  // 0x204: V1 = 0x34
+      0xA2, 0x10,  // 0x206: I = 0x210
+      0xF1, 0x55,  // 0x208: store V0..V1, rewriting 0x210 to 1234
+      0x22, 0x10,  // 0x20A: call 0x210 again
+      0x00, 0x00,  // 0x20C
+      0x00, 0x00,  // 0x20E
+      0x60, 0x99,  // 0x210: V0 = 0x99
+      0x00, 0xEE,  // 0x212: return
+  };
+
+  memcpy(emulator->memory + 0x200, rom, sizeof(rom));
+  chip8_invalidate(emulator, 0x200, sizeof(rom));
+
+  assert(chip8_execute(emulator, 9));
+  assert(emulator->instructions == 9);
+
+  // The rewritten instruction must run, not the stale predecoded one.
+  assert(emulator->PC == 0x234);
+  assert(emulator->V[0] == 0x12);
+
+  // Unknown instructions still fail.
+  emulator->memory[0x234] = 0xFF;
+  emulator->memory[0x235] = 0xFF;
+  chip8_invalidate(emulator, 0x234, 2);
+  assert(chip8_execute(emulator, 1) == false);
+
+  chip8_destroy(emulator);
+
+  return 0;  // Success
+}
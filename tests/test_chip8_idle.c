@@ -0,0 +1,114 @@
+#include <assert.h>
+#include <stdlib.h>
+#include "../include/idle.h"
+#include "../include/state.h"
+
+static const uint8_t rom[] = {
+    0x60, 0x05,  // 0x200: V0 = 5
+    0xF0, 0x15,  // 0x202: delay timer = V0
+    0xF1, 0x07,  // 0x204: V1 = delay timer
+    0x31, 0x00,  // 0x206: skip if V1 == 0
+    0x12, 0x04,  // 0x208: jump 0x204
+    0x72, 0x01,  // 0x20A: V2 += 1
+    0xF3, 0x0A,  // 0x20C: V3 = next key
+    0x74, 0x01,  // 0x20E: V4 += 1
+    0x12, 0x10,  // 0x210: jump 0x210
+};
+
+static CHIP8* create(uint8_t backend, bool busy_wait) {
+  CHIP8* emulator = chip8_new();
+  assert(emulator != NULL);
+
+  emulator->backend = backend;
+  emulator->busy_wait = busy_wait;
+  // Not a multiple of any loop length, so frames end mid-pass
+  emulator->instructions_per_frame = 700;
+  assert(chip8_load_bytes(emulator, rom, sizeof(rom)));
+
+  return emulator;
+}
+
+static void run(CHIP8* emulator, uint64_t frames, bool key) {
+  emulator->keypad[7] = key;
+  for (uint64_t i = 0; i < frames; i++) {
+    assert(chip8_run_frame(emulator));
+  }
+}
+
+int main(void) {
+  const uint8_t backends[] = {BACKEND_CACHED, BACKEND_SWITCH,
+                              BACKEND_THREADED, BACKEND_JIT};
+
+  CHIP8* reference = create(BACKEND_CACHED, true);
+  run(reference, 3, false);
+  uint64_t polling = chip8_state_hash(reference);
+  run(reference, 5, false);
+  uint64_t waiting = chip8_state_hash(reference);
+  run(reference, 2, true);
+  uint64_t halted = chip8_state_hash(reference);
+  assert(reference->idle_instructions == 0);
+  assert(reference->V[2] == 1 && reference->V[3] == 7 &&
+         reference->V[4] == 1 && reference->PC == 0x210);
+
+  // Skipping the delay timer loop, the key wait and the jump to itself
+  // leaves every backend exactly where executing them would.
+  for (size_t i = 0; i < sizeof(backends); i++) {
+    CHIP8* emulator = create(backends[i], false);
+
+    run(emulator, 3, false);
+    assert(chip8_state_hash(emulator) == polling);
+    uint64_t skipped = emulator->idle_instructions;
+    assert(skipped > 0);
+
+    run(emulator, 5, false);
+    assert(chip8_state_hash(emulator) == waiting);
+    assert(emulator->idle_instructions > skipped);
+    skipped = emulator->idle_instructions;
+
+    run(emulator, 2, true);
+    assert(chip8_state_hash(emulator) == halted);
+    assert(emulator->idle_instructions > skipped);
+    assert(emulator->instructions == reference->instructions);
+
+    chip8_destroy(emulator);
+  }
+
+  // A loop that makes progress is never skipped.
+  CHIP8* counting = create(BACKEND_CACHED, false);
+  counting->memory[0x210] = 0x70;
+  counting->memory[0x211] = 0x01;
+  counting->memory[0x212] = 0x12;
+  counting->memory[0x213] = 0x10;
+  chip8_invalidate(counting, 0x210, 4);
+  counting->PC = 0x210;
+  run(counting, 1, false);
+  assert(counting->idle_instructions == 0);
+  assert(counting->V[0] == 350 % 256);
+
+  // Busy code is not even single-stepped while looking, at any phase.
+  for (uint16_t pc = 0x210; pc <= 0x212; pc += 2) {
+    bool success = true;
+    uint64_t instructions = counting->instructions;
+    counting->PC = pc;
+    assert(chip8_idle_skip(counting, INSTRUCTIONS_PER_FRAME, &success) == 0);
+    assert(success && counting->PC == pc);
+    assert(counting->instructions == instructions);
+  }
+  chip8_destroy(counting);
+
+  // The default frame length is still long enough to skip the loops.
+  CHIP8* short_reference = create(BACKEND_CACHED, true);
+  CHIP8* short_frames = create(BACKEND_CACHED, false);
+  short_reference->instructions_per_frame = INSTRUCTIONS_PER_FRAME;
+  short_frames->instructions_per_frame = INSTRUCTIONS_PER_FRAME;
+  run(short_reference, 10, false);
+  run(short_frames, 10, false);
+  assert(chip8_state_hash(short_frames) == chip8_state_hash(short_reference));
+  assert(short_frames->idle_instructions > 0);
+  chip8_destroy(short_reference);
+  chip8_destroy(short_frames);
+
+  chip8_destroy(reference);
+
+  return EXIT_SUCCESS;
+}
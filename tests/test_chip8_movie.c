@@ -0,0 +1,163 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "../include/movie.h"
+
+static const uint8_t rom[] = {
+    0xC0, 0xFF,  // 0x200: V0 = random
+    0xE1, 0x9E,  // 0x202: skip if key V1 is pressed
+    0x72, 0x01,  // 0x204: V2 += 1
+    0x83, 0x04,  // 0x206: V3 += V0
+    0xC4, 0x00,  // 0x208: V4 = random & 0
+    0x12, 0x00,  // 0x20A: jump 0x200
+};
+
+// Runs a frame the way the live session does while recording
+static void record_frame(CHIP8* emulator, CHIP8_MOVIE* movie, uint16_t keys) {
+  assert(chip8_movie_record(movie, emulator->frames, keys));
+  for (size_t i = 0; i < KEYPAD_SIZE; i++) {
+    emulator->keypad[i] = (keys >> i) & 1;
+  }
+  assert(chip8_run_frame(emulator));
+}
+
+int main(void) {
+  // The same seed gives the same numbers, and a zero mask no longer traps.
+  CHIP8* first = chip8_new();
+  CHIP8* second = chip8_new();
+  assert(first != NULL && second != NULL);
+  assert(chip8_load_bytes(first, rom, sizeof(rom)));
+  assert(chip8_load_bytes(second, rom, sizeof(rom)));
+  chip8_seed(first, 7);
+  chip8_seed(second, 7);
+  assert(chip8_execute(first, 600));
+  assert(chip8_execute(second, 600));
+  assert(first->V[3] == second->V[3] && first->V[4] == 0);
+  chip8_seed(second, 8);
+  chip8_reset(second);
+  assert(second->random == 8);
+  chip8_destroy(second);
+
+  // The generator is part of the save state.
+  uint8_t state[STATE_SIZE];
+  assert(chip8_state_save(first, state, sizeof(state)));
+  uint64_t hash = chip8_state_hash(first);
+  assert(chip8_execute(first, 60));
+  assert(chip8_state_hash(first) != hash);
+  assert(chip8_state_load(first, state, sizeof(state)));
+  assert(chip8_state_hash(first) == hash);
+  chip8_destroy(first);
+
+  // Record with a rewind in the middle: the input after the point rewound
+  // to is replaced.
+  CHIP8* recorded = chip8_new();
+  assert(recorded != NULL);
+  assert(chip8_load_bytes(recorded, rom, sizeof(rom)));
+  chip8_seed(recorded, 1234);
+  CHIP8_MOVIE* movie = chip8_movie_new(recorded);
+  assert(movie != NULL);
+
+  for (uint16_t frame = 0; frame < 50; frame++) {
+    record_frame(recorded, movie, (frame / 7) % 2);
+  }
+  assert(chip8_state_save(recorded, state, sizeof(state)));
+  for (uint16_t frame = 50; frame < 70; frame++) {
+    record_frame(recorded, movie, 1);
+  }
+  assert(chip8_state_load(recorded, state, sizeof(state)));
+  for (uint16_t frame = 50; frame < 100; frame++) {
+    record_frame(recorded, movie, frame % 3 == 0 ? 0x8001 : 0);
+  }
+  chip8_movie_finish(movie, recorded);
+  assert(movie->frames == 100);
+  assert(movie->state_hash == chip8_state_hash(recorded));
+
+  char file_name[] = "/tmp/chipcraft_movie_XXXXXX";
+  int fd = mkstemp(file_name);
+  assert(fd >= 0);
+  close(fd);
+  assert(chip8_movie_save(movie, file_name));
+
+  // Every backend replays the movie to the same final state.
+  const uint8_t backends[] = {BACKEND_CACHED, BACKEND_SWITCH,
+                              BACKEND_THREADED, BACKEND_JIT};
+  for (size_t i = 0; i < sizeof(backends); i++) {
+    CHIP8_MOVIE* loaded = chip8_movie_load(file_name);
+    assert(loaded != NULL);
+    assert(loaded->count == movie->count && loaded->seed == 1234);
+
+    CHIP8* replayed = chip8_new();
+    assert(replayed != NULL);
+    assert(chip8_load_bytes(replayed, rom, sizeof(rom)));
+    replayed->backend = backends[i];
+    assert(chip8_movie_start(replayed, loaded));
+    assert(chip8_movie_replay(replayed, loaded));
+    assert(replayed->frames == 100);
+    assert(chip8_state_hash(replayed) == movie->state_hash);
+
+    chip8_movie_destroy(loaded);
+    chip8_destroy(replayed);
+  }
+
+  // A different ROM is refused, and a different result is reported.
+  CHIP8* other = chip8_new();
+  assert(other != NULL);
+  assert(chip8_load_bytes(other, rom, sizeof(rom)));
+  other->memory[0x205] = 0x02;
+  assert(chip8_movie_start(other, movie) == false);
+  chip8_destroy(other);
+
+  other = chip8_new();
+  assert(other != NULL);
+  assert(chip8_load_bytes(other, rom, sizeof(rom)));
+  movie->state_hash ^= 1;
+  assert(chip8_movie_start(other, movie));
+  assert(chip8_movie_replay(other, movie) == false);
+  chip8_destroy(other);
+
+  // Truncated files are rejected.
+  FILE* fp = fopen(file_name, "r+b");
+  assert(fp != NULL);
+  assert(ftruncate(fileno(fp), MOVIE_HEADER_SIZE + MOVIE_EVENT_SIZE) == 0);
+  fclose(fp);
+  assert(movie->count > 1);
+  assert(chip8_movie_load(file_name) == NULL);
+
+  // Event frames past 32 bits survive a save and load.
+  CHIP8_MOVIE* long_run = chip8_movie_new(recorded);
+  assert(long_run != NULL);
+  assert(chip8_movie_record(long_run, UINT32_MAX, 1));
+  assert(chip8_movie_record(long_run, UINT64_C(1) << 32, 2));
+  long_run->frames = (UINT64_C(1) << 32) + 1;
+  assert(chip8_movie_save(long_run, file_name));
+  chip8_movie_destroy(long_run);
+  long_run = chip8_movie_load(file_name);
+  assert(long_run != NULL && long_run->count == 2);
+  assert(long_run->events[0].frame == UINT32_MAX);
+  assert(long_run->events[1].frame == UINT64_C(1) << 32);
+  assert(long_run->events[1].keys == 2);
+  chip8_movie_destroy(long_run);
+
+  // Version 1 movies with 32-bit event frames still load.
+  uint8_t old[MOVIE_HEADER_SIZE + MOVIE_EVENT_SIZE_V1] = {0};
+  memcpy(old, MOVIE_MAGIC, 4);
+  state_put16(old + 4, 1);
+  state_put16(old + 12, INSTRUCTIONS_PER_FRAME);
+  state_put64(old + 24, 10);
+  state_put64(old + 40, 1);
+  state_put32(old + MOVIE_HEADER_SIZE, 3);
+  state_put16(old + MOVIE_HEADER_SIZE + 4, 5);
+  fp = fopen(file_name, "wb");
+  assert(fp != NULL && fwrite(old, 1, sizeof(old), fp) == sizeof(old));
+  fclose(fp);
+  CHIP8_MOVIE* old_movie = chip8_movie_load(file_name);
+  assert(old_movie != NULL && old_movie->count == 1);
+  assert(old_movie->events[0].frame == 3 && old_movie->events[0].keys == 5);
+  chip8_movie_destroy(old_movie);
+
+  unlink(file_name);
+  chip8_movie_destroy(movie);
+  chip8_destroy(recorded);
+
+  return EXIT_SUCCESS;
+}
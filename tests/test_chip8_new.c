@@ -0,0 +1,32 @@
+#include <assert.h>
+#include <stdlib.h>
+#include "../include/chip8.h"
+
+int main(void) {
+  CHIP8* first = chip8_new();
+  CHIP8* second = chip8_new();
+  assert(first != NULL);
+  assert(second != NULL);
+  assert(first != second);
+  assert(first->PC == 0x200);
+  assert(first->stack.top == (size_t)-1);
+
+  // Instances must not share registers or stacks.
+  first->V[0] = 0x42;
+  assert(stack_push(&first->stack, 0x300));
+  assert(second->V[0] == 0);
+  assert(second->stack.top == (size_t)-1);
+
+  // Reset returns an instance to its power-on state.
+  first->PC = 0x400;
+  chip8_reset(first);
+  assert(first->V[0] == 0);
+  assert(first->PC == 0x200);
+  assert(first->stack.top == (size_t)-1);
+  assert(first->memory[0] == 0xF0);  // Font for 0 is reloaded
+
+  chip8_destroy(first);
+  chip8_destroy(second);
+
+  return 0;  // Success
+}
@@ -0,0 +1,87 @@
+#include <assert.h>
+#include <stdlib.h>
+#include "../include/profiler.h"
+#include "../include/state.h"
+
+static const uint8_t rom[] = {
+    0x22, 0x08,  // 0x200: call 0x208
+    0x70, 0x01,  // 0x202: V0 += 1
+    0x12, 0x00,  // 0x204: jump 0x200
+    0x00, 0x00,
+    0x71, 0x01,  // 0x208: V1 += 1
+    0x22, 0x0E,  // 0x20A: call 0x20E
+    0x00, 0xEE,  // 0x20C: return
+    0x72, 0x01,  // 0x20E: V2 += 1
+    0x00, 0xEE,  // 0x210: return
+};
+
+// Reads everything written to a temporary file back as a string
+static char* read_back(FILE* fp) {
+  long size = ftell(fp);
+  char* text = calloc(size + 1, 1);
+  assert(text != NULL);
+
+  rewind(fp);
+  assert(fread(text, 1, size, fp) == (size_t)size);
+  fclose(fp);
+
+  return text;
+}
+
+int main(void) {
+  CHIP8* emulator = chip8_new();
+  assert(emulator != NULL);
+
+  memcpy(emulator->memory + 0x200, rom, sizeof(rom));
+  chip8_invalidate(emulator, 0x200, sizeof(rom));
+
+  // Compiled backends are bypassed while a profile is attached.
+  emulator->backend = BACKEND_JIT;
+  emulator->profile = chip8_profile_new();
+  assert(emulator->profile != NULL);
+
+  // 100 trips through the loop, 8 instructions each
+  assert(chip8_execute(emulator, 800));
+  assert(emulator->PC == 0x200);
+  assert(emulator->V[0] == 100 && emulator->V[1] == 100 &&
+         emulator->V[2] == 100);
+  assert(chip8_profile_hits(emulator->profile, 0x200) == 100);
+  assert(chip8_profile_hits(emulator->profile, 0x210) == 100);
+  assert(chip8_profile_hits(emulator->profile, 0x206) == 0);
+
+  // Frames run ahead and thrown away are not counted.
+  uint64_t future[DISPLAY_HEIGHT];
+  assert(chip8_run_ahead(emulator, 2, future));
+  assert(chip8_profile_hits(emulator->profile, 0x200) == 100);
+
+  FILE* fp = tmpfile();
+  assert(fp != NULL);
+  assert(chip8_profile_write_folded(emulator->profile, fp));
+  char* folded = read_back(fp);
+  assert(strstr(folded, "main;pc_204 100\n") != NULL);
+  assert(strstr(folded, "main;sub_208;pc_20C 100\n") != NULL);
+  assert(strstr(folded, "main;sub_208;sub_20E;pc_20E 100\n") != NULL);
+  assert(strstr(folded, "main;sub_20E") == NULL);
+  free(folded);
+
+  // The inner call counts towards the outer one inclusively only.
+  fp = tmpfile();
+  assert(fp != NULL);
+  chip8_profile_report(emulator->profile, fp);
+  char* report = read_back(fp);
+  assert(strstr(report, "0x208               100            300"
+                        "            500\n") != NULL);
+  assert(strstr(report, "0x20E               100            200"
+                        "            200\n") != NULL);
+  free(report);
+
+  // The profile outlives a reset and starts over when asked to.
+  chip8_reset(emulator);
+  assert(emulator->profile != NULL);
+  chip8_profile_reset(emulator->profile);
+  assert(chip8_profile_hits(emulator->profile, 0x200) == 0);
+
+  chip8_destroy(emulator);
+
+  return EXIT_SUCCESS;
+}
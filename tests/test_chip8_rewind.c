@@ -0,0 +1,76 @@
+#include <assert.h>
+#include <stdlib.h>
+#include "../include/rewind.h"
+
+#define FRAMES 400
+
+static const uint8_t rom[] = {
+    0xA2, 0x20,  // 0x200: I = 0x220
+    0x60, 0x00,  // 0x202: V0 = 0
+    0xD0, 0x05,  // 0x204: draw 5 rows at V0, V0
+    0x70, 0x01,  // 0x206: V0 += 1
+    0xF0, 0x33,  // 0x208: BCD of V0 at I
+    0x12, 0x04,  // 0x20A: jump 0x204
+};
+
+static uint8_t states[FRAMES][STATE_SIZE];
+
+// Runs FRAMES frames, capturing each one, and steps back through them all
+static void check(size_t frames, size_t arena_size) {
+  CHIP8* emulator = chip8_new();
+  CHIP8_REWIND* rewind = chip8_rewind_new(frames, arena_size);
+  uint8_t state[STATE_SIZE];
+  assert(emulator != NULL && rewind != NULL);
+  assert(chip8_load_bytes(emulator, rom, sizeof(rom)));
+
+  for (size_t frame = 0; frame < FRAMES; frame++) {
+    assert(chip8_run_frame(emulator));
+    assert(chip8_rewind_capture(rewind, emulator));
+    assert(chip8_state_save(emulator, states[frame], STATE_SIZE));
+    assert(chip8_rewind_count(rewind) <= frames);
+  }
+
+  size_t kept = chip8_rewind_count(rewind);
+  assert(kept > 1);
+
+  for (size_t i = 1; i < kept; i++) {
+    assert(chip8_rewind_step(rewind, emulator));
+    assert(chip8_state_save(emulator, state, STATE_SIZE));
+    assert(memcmp(state, states[FRAMES - 1 - i], STATE_SIZE) == 0);
+  }
+
+  // The oldest kept frame is as far back as it goes.
+  assert(chip8_rewind_step(rewind, emulator) == false);
+  assert(chip8_rewind_count(rewind) == 1);
+
+  // Capturing again after stepping back continues from there.
+  assert(chip8_run_frame(emulator));
+  assert(chip8_rewind_capture(rewind, emulator));
+  assert(chip8_rewind_step(rewind, emulator));
+  assert(chip8_state_save(emulator, state, STATE_SIZE));
+  assert(memcmp(state, states[FRAMES - kept], STATE_SIZE) == 0);
+
+  chip8_rewind_destroy(rewind);
+  chip8_destroy(emulator);
+}
+
+int main(void) {
+  // Everything fits
+  check(REWIND_FRAMES, REWIND_ARENA_SIZE);
+  check(FRAMES, REWIND_ARENA_SIZE);
+
+  // The entry ring and the arena each force old frames out.
+  check(150, REWIND_ARENA_SIZE);
+  check(REWIND_FRAMES, 3 * STATE_SIZE + 20000);
+
+  // Not even a keyframe fits.
+  CHIP8* emulator = chip8_new();
+  CHIP8_REWIND* rewind = chip8_rewind_new(8, STATE_SIZE - 1);
+  assert(emulator != NULL && rewind != NULL);
+  assert(chip8_load_bytes(emulator, rom, sizeof(rom)));
+  assert(chip8_rewind_capture(rewind, emulator) == false);
+  chip8_rewind_destroy(rewind);
+  chip8_destroy(emulator);
+
+  return 0;  // Success
+}
@@ -0,0 +1,84 @@
+#include <assert.h>
+#include <stdlib.h>
+#include "../include/state.h"
+
+static const uint8_t rom[] = {
+    0xA2, 0x20,  // 0x200: I = 0x220
+    0x60, 0x00,  // 0x202: V0 = 0
+    0xD0, 0x05,  // 0x204: draw 5 rows at V0, V0
+    0x70, 0x01,  // 0x206: V0 += 1
+    0x22, 0x10,  // 0x208: call 0x210
+    0x12, 0x04,  // 0x20A: jump 0x204
+    0x00, 0x00, 0x00, 0x00,
+    0xF0, 0x33,  // 0x210: BCD of V0 at I
+    0xF1, 0x15,  // 0x212: delay timer = V1
+    0x71, 0x03,  // 0x214: V1 += 3
+    0x00, 0xEE,  // 0x216: return
+};
+
+int main(void) {
+  uint8_t state[STATE_SIZE];
+  CHIP8* emulator = chip8_new();
+  CHIP8* restored = chip8_new();
+  assert(emulator != NULL && restored != NULL);
+  assert(chip8_load_bytes(emulator, rom, sizeof(rom)));
+  assert(chip8_load_bytes(restored, rom, sizeof(rom)));
+
+  for (size_t frame = 0; frame < 50; frame++) {
+    assert(chip8_run_frame(emulator));
+  }
+  assert(chip8_state_save(emulator, state, sizeof(state)));
+  assert(memcmp(state, STATE_MAGIC, 4) == 0);
+  assert(state[4] == STATE_VERSION && state[5] == 0);
+
+  // Little-endian regardless of the host
+  assert(state[26] == (emulator->PC & 0xFF));
+  assert(state[27] == emulator->PC >> 8);
+
+  // Restoring into another instance continues exactly like the original.
+  assert(chip8_state_load(restored, state, sizeof(state)));
+  for (size_t frame = 0; frame < 50; frame++) {
+    assert(chip8_run_frame(emulator));
+    assert(chip8_run_frame(restored));
+  }
+
+  uint8_t expected[STATE_SIZE];
+  uint8_t actual[STATE_SIZE];
+  assert(chip8_state_save(emulator, expected, sizeof(expected)));
+  assert(chip8_state_save(restored, actual, sizeof(actual)));
+  assert(memcmp(expected, actual, STATE_SIZE) == 0);
+
+  // Restoring in place rewinds the instance, including memory it wrote.
+  assert(chip8_state_load(emulator, state, sizeof(state)));
+  assert(chip8_state_save(emulator, actual, sizeof(actual)));
+  assert(memcmp(state, actual, STATE_SIZE) == 0);
+
+  // Bad blobs are rejected without touching the instance.
+  uint16_t pc = emulator->PC;
+  assert(chip8_state_load(emulator, state, STATE_SIZE - 1) == false);
+  state[0] = 'X';
+  assert(chip8_state_load(emulator, state, sizeof(state)) == false);
+  state[0] = 'C';
+  state[4] = STATE_VERSION + 1;
+  assert(chip8_state_load(emulator, state, sizeof(state)) == false);
+  assert(emulator->PC == pc);
+
+  // Running ahead shows the future display and leaves the present alone.
+  uint64_t future[DISPLAY_HEIGHT];
+  assert(chip8_state_load(emulator, expected, sizeof(expected)));
+  assert(chip8_state_load(restored, expected, sizeof(expected)));
+  assert(chip8_run_ahead(emulator, 3, future));
+  assert(chip8_state_save(emulator, actual, sizeof(actual)));
+  assert(memcmp(expected, actual, STATE_SIZE) == 0);
+  assert(emulator->dirty_rows == 0);
+  for (size_t frame = 0; frame < 3; frame++) {
+    assert(chip8_run_frame(restored));
+  }
+  assert(memcmp(future, restored->display, sizeof(future)) == 0);
+  assert(memcmp(future, emulator->display, sizeof(future)) != 0);
+
+  chip8_destroy(emulator);
+  chip8_destroy(restored);
+
+  return 0;  // Success
+}
@@ -0,0 +1,45 @@
+#include <assert.h>
+#include <stdlib.h>
+#include "../include/chip8.h"
+#include "../include/opcodes.h"
+
+int main(void) {
+  CHIP8* emulator = chip8_new();
+  assert(emulator != NULL);
+
+  // 0x200: V0 += 1, 0x202: V1 = V0, 0x204: jump 0x200
+  const uint8_t rom[] = {0x70, 0x01, 0x81, 0x00, 0x12, 0x00};
+  memcpy(emulator->memory + 0x200, rom, sizeof(rom));
+  chip8_invalidate(emulator, 0x200, sizeof(rom));
+
+  // The macros expand to nothing or to a statement either way.
+  STATS_DECLARE(start);
+  STATS_PHASE_BEGIN(start);
+  assert(chip8_execute(emulator, 300));
+  STATS_PHASE_END(start, PHASE_EXECUTE);
+  assert(chip8_decode_execute(emulator, 0x6A42));
+
+  assert(strcmp(chip8_opcode_names[OP_DRW], "DXYN DRW") == 0);
+
+#ifdef CHIP8_STATS
+  // Every execution is counted, not only the sampled ones.
+  assert(chip8_stats_count(OP_ADD_BYTE) == 100);
+  assert(chip8_stats_count(OP_LD_REG) == 100);
+  assert(chip8_stats_count(OP_JP) == 100);
+  assert(chip8_stats_count(OP_LD_BYTE) == 1);
+  assert(chip8_stats_count(OP_DRW) == 0);
+
+  FILE* out = tmpfile();
+  assert(out != NULL);
+  STATS_DUMP(out);
+  assert(ftell(out) > 0);
+  fclose(out);
+
+  chip8_stats_reset();
+  assert(chip8_stats_count(OP_ADD_BYTE) == 0);
+#endif
+
+  chip8_destroy(emulator);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,65 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include "../include/frame.h"
+
+#define FRAMES 200000
+
+static CHIP8_FRAME_BUFFER buffer;
+
+static void* produce(void* data) {
+  (void)data;
+
+  for (uint64_t sequence = 1; sequence <= FRAMES; sequence++) {
+    CHIP8_FRAME* frame = frame_buffer_back(&buffer);
+    for (size_t row = 0; row < DISPLAY_HEIGHT; row++) {
+      frame->rows[row] = sequence;
+    }
+    frame->sequence = sequence;
+    frame_buffer_publish(&buffer);
+  }
+
+  return NULL;
+}
+
+int main(void) {
+  const CHIP8_FRAME* frame = NULL;
+  pthread_t producer;
+
+  frame_buffer_init(&buffer);
+
+  // Nothing has been published yet.
+  assert(frame_buffer_acquire(&buffer, &frame) == false);
+  assert(frame->sequence == 0);
+
+  // Only the newest of several unconsumed frames is seen.
+  for (uint64_t sequence = 1; sequence <= 3; sequence++) {
+    frame_buffer_back(&buffer)->sequence = sequence;
+    frame_buffer_publish(&buffer);
+  }
+  assert(frame_buffer_acquire(&buffer, &frame) == true);
+  assert(frame->sequence == 3);
+  assert(frame_buffer_acquire(&buffer, &frame) == false);
+  assert(frame->sequence == 3);
+
+  // Under contention every frame is complete and they never go backwards.
+  frame_buffer_init(&buffer);
+  assert(pthread_create(&producer, NULL, produce, NULL) == 0);
+
+  uint64_t last = 0;
+  while (last < FRAMES) {
+    if (frame_buffer_acquire(&buffer, &frame) == false) {
+      continue;
+    }
+
+    assert(frame->sequence > last);
+    for (size_t row = 0; row < DISPLAY_HEIGHT; row++) {
+      assert(frame->rows[row] == frame->sequence);
+    }
+    last = frame->sequence;
+  }
+
+  pthread_join(producer, NULL);
+
+  return 0;  // Success
+}
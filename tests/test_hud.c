@@ -0,0 +1,77 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/hud.h"
+#include "../include/chip8.h"
+
+static uint32_t pixels[HUD_HEIGHT * HUD_WIDTH];
+
+static bool lit(int x, int y) {
+  return pixels[y * HUD_WIDTH + x] == HUD_TEXT_COLOR;
+}
+
+int main(void) {
+  // Glyphs are drawn top row first, left column first.
+  hud_print(pixels, 0, 0, "1");
+  assert(lit(1, 0) && !lit(0, 0) && !lit(2, 0));
+  assert(lit(0, 1) && lit(1, 1) && !lit(2, 1));
+  assert(lit(0, 4) && lit(1, 4) && lit(2, 4));
+
+  // Lowercase is drawn as uppercase, unknown characters are blank and
+  // text running off the overlay is clipped.
+  memset(pixels, 0, sizeof(pixels));
+  hud_print(pixels, 0, 0, "l");
+  assert(lit(0, 0) && lit(0, 4) && lit(2, 4) && !lit(2, 0));
+  memset(pixels, 0, sizeof(pixels));
+  hud_print(pixels, 0, 0, "#");
+  for (size_t i = 0; i < HUD_WIDTH * HUD_HEIGHT; i++) {
+    assert(pixels[i] == 0);
+  }
+  hud_print(pixels, HUD_WIDTH - 2, HUD_HEIGHT - 2, "88");
+
+  // Half a second with 330 frames' worth of instructions and 30 frames
+  // at 2 ms each, presented 30 times in 1 ms and 8 ms.
+  const uint64_t frequency = 1000000;
+  CHIP8_HUD_COUNTERS previous = {1000000, 5000, 100, 2, 0, 0, 0, 0, 0};
+  CHIP8_HUD_COUNTERS current = {1500000, 5330, 130, 3, 60000,
+                                30000, 240000, 30, SPEED_UNCAPPED};
+  CHIP8_HUD_STATS stats;
+  hud_compute(&previous, &current, frequency, &stats);
+  assert(stats.instructions_per_second == 660);
+  assert(stats.speed == 1);
+  assert(stats.execute_ms == 2);
+  assert(stats.draw_ms == 1);
+  assert(stats.present_ms == 8);
+  assert(stats.dropped == 3);
+
+  char lines[HUD_LINES][HUD_COLUMNS + 1];
+  hud_format(&stats, lines);
+  assert(strcmp(lines[0], "IPS        660") == 0);
+  assert(strcmp(lines[1], "EXEC   2.00 MS") == 0);
+  assert(strcmp(lines[4], "DROP         3") == 0);
+  assert(strcmp(lines[5], "SPEED    1.00X") == 0);
+  assert(strcmp(lines[6], "LIMIT     NONE") == 0);
+  current.speed = 8;
+  hud_compute(&previous, &current, frequency, &stats);
+  hud_format(&stats, lines);
+  assert(strcmp(lines[6], "LIMIT       8X") == 0);
+
+  // F3 doubles the speed up to SPEED_MAX and then uncaps it, F2 undoes it.
+  uint8_t speed = 1;
+  for (int i = 0; i < 6; i++) {
+    speed = chip8_speed_step(speed, true);
+  }
+  assert(speed == SPEED_MAX);
+  assert(chip8_speed_step(speed, true) == SPEED_UNCAPPED);
+  assert(chip8_speed_step(SPEED_UNCAPPED, true) == SPEED_UNCAPPED);
+  assert(chip8_speed_step(SPEED_UNCAPPED, false) == SPEED_MAX);
+  assert(chip8_speed_step(2, false) == 1);
+  assert(chip8_speed_step(1, false) == 1);
+
+  // Nothing happening in between gives zeros rather than dividing by zero.
+  hud_compute(&current, &current, frequency, &stats);
+  assert(stats.instructions_per_second == 0 && stats.execute_ms == 0 &&
+         stats.present_ms == 0 && stats.speed == 0);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,99 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/log_async.h"
+
+#define EVENTS 20000
+
+static void* producer(void* data) {
+  (void)data;
+
+  for (unsigned long long i = 0; i < EVENTS; i++) {
+    log_async(LOG_INFO, "event %llu of %llu", i, (unsigned long long)EVENTS);
+  }
+
+  return NULL;
+}
+
+int main(void) {
+  FILE* fp = tmpfile();
+  assert(fp != NULL);
+
+  // Nothing is recorded before the writer starts. The level macros can be
+  // compiled out, so the checked events use log_async() directly.
+  log_async(LOG_ERROR, "not started");
+  assert(log_async_dropped() == 0);
+
+  assert(log_async_start(fp, LOG_INFO));
+  assert(log_async_start(fp, LOG_INFO) == false);
+
+  log_async(LOG_DEBUG, "below the level");
+  log_async_set_level(LOG_WARN);
+  log_async(LOG_INFO, "below the new level");
+  log_async_set_level(LOG_INFO);
+
+  // Arguments are not evaluated for a level that is filtered out.
+  int evaluated = 0;
+  log_async(LOG_DEBUG, "%llu", (unsigned long long)++evaluated);
+  assert(evaluated == 0);
+  log_async(LOG_WARN, "no arguments, 100%%");
+  log_async(LOG_ERROR, "four %llu %llu %llX %llu", 1, 2, 0xABC, 4);
+
+  pthread_t threads[2];
+  for (size_t i = 0; i < 2; i++) {
+    assert(pthread_create(&threads[i], NULL, producer, NULL) == 0);
+  }
+  for (size_t i = 0; i < 2; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  log_async_stop();
+
+  // Every event is either written or counted in a drop report.
+  char line[256];
+  unsigned long long written = 0;
+  unsigned long long dropped = 0;
+  bool warned = false;
+  bool four = false;
+
+  rewind(fp);
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    char* text = NULL;
+    unsigned long long count = 0;
+
+    assert(strstr(line, "below the") == NULL);
+    assert(strstr(line, "not started") == NULL);
+    assert(line[strlen(line) - 1] == '\n');
+
+    if ((text = strstr(line, "dropped ")) != NULL) {
+      assert(sscanf(text, "dropped %llu events", &count) == 1);
+      dropped += count;
+    } else if (strstr(line, "event ") != NULL) {
+      assert(strstr(line, "INFO") != NULL);
+      assert(strstr(line, "test_log_async.c:") != NULL);
+      written++;
+    } else if (strstr(line, "no arguments, 100%\n") != NULL) {
+      warned = true;
+    } else if (strstr(line, "four 1 2 ABC 4\n") != NULL) {
+      four = true;
+    }
+  }
+
+  assert(warned && four);
+  assert(written + dropped == 2 * EVENTS);
+
+  // The logger can be started again, and new threads get new rings.
+  assert(log_async_start(fp, LOG_TRACE));
+  log_async_trace("again");
+  log_async_stop();
+
+  fclose(fp);
+
+  // The synchronous macros check the level inline as well.
+  log_set_quiet(true);
+  log_info("%d", ++evaluated);
+  assert(evaluated == 0);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,174 @@
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/romlib.h"
+
+static char directory[] = "/tmp/chipcraft-romlib-XXXXXX";
+static char path[PATH_MAX];
+
+static const uint8_t pong[] = {0x60, 0x01, 0x12, 0x02};
+static const uint8_t maze[] = {0xA2, 0x1E, 0xC2, 0x01, 0x32, 0x01};
+static const uint8_t blank[] = {0x00, 0xE0, 0x12, 0x02};
+// Longer than an archive entry holds
+static const char long_name[] =
+    "a-rom-with-a-name-too-long-for-an-archive-entry.ch8";
+
+static const char* file(const char* name) {
+  snprintf(path, sizeof(path), "%s/%s", directory, name);
+  return path;
+}
+
+static void write_file(const char* name, const void* data, size_t size) {
+  FILE* fp = fopen(file(name), "wb");
+  assert(fp != NULL);
+  assert(fwrite(data, 1, size, fp) == size);
+  assert(fclose(fp) == 0);
+}
+
+static void check(const CHIP8_ROMLIB* library) {
+  assert(library->count == 4);
+  for (size_t i = 1; i < library->count; i++) {
+    assert(library->roms[i - 1].hash <= library->roms[i].hash);
+  }
+
+  const CHIP8_ROM* rom = chip8_romlib_find(
+      library, chip8_hash_bytes(pong, sizeof(pong)));
+  assert(rom != NULL && rom->size == sizeof(pong));
+  // The hash finds the first name in sorted order
+  assert(strcmp(rom->name, "a-pong.ch8") == 0);
+  assert(rom->settings.instructions_per_frame == 30);
+  assert(rom->settings.seed == 99);
+
+  // Every name of identical ROMs is an alias of the same ROM
+  const CHIP8_ROM* alias = chip8_romlib_lookup(library, "pong.ch8");
+  assert(alias != NULL && alias != rom && alias->hash == rom->hash);
+  assert(alias->size == rom->size);
+  assert(alias->settings.instructions_per_frame == 30);
+  assert(chip8_romlib_lookup(library, "a-pong.ch8") == rom);
+
+  char hash[17];
+  snprintf(hash, sizeof(hash), "%016llX", (unsigned long long)rom->hash);
+  assert(chip8_romlib_lookup(library, hash) == rom);
+
+  rom = chip8_romlib_lookup(library, "maze.ch8");
+  assert(rom != NULL && rom->settings.instructions_per_frame == 0);
+  assert(chip8_romlib_find(library, rom->hash + 1) == NULL);
+
+  // Loading copies the ROM and applies its settings.
+  CHIP8* emulator = chip8_new();
+  assert(emulator != NULL);
+  assert(chip8_romlib_load(emulator, chip8_romlib_lookup(library,
+                                                         "a-pong.ch8")));
+  assert(memcmp(emulator->memory + 0x200, pong, sizeof(pong)) == 0);
+  assert(emulator->instructions_per_frame == 30 && emulator->seed == 99);
+  assert(chip8_run_frame(emulator) && emulator->V[0] == 1);
+  chip8_destroy(emulator);
+
+  emulator = chip8_new();
+  assert(emulator != NULL);
+  assert(chip8_romlib_load(emulator, alias));
+  assert(memcmp(emulator->memory + 0x200, pong, sizeof(pong)) == 0);
+  chip8_destroy(emulator);
+}
+
+static bool load(const CHIP8_ROMLIB* library, const char* name) {
+  CHIP8* emulator = chip8_new();
+  assert(emulator != NULL);
+  bool loaded = chip8_romlib_load(emulator,
+                                  chip8_romlib_lookup(library, name));
+  chip8_destroy(emulator);
+
+  return loaded;
+}
+
+int main(void) {
+  uint8_t large[ROMLIB_ROM_MAX + 1] = {0};
+  char settings[128];
+
+  assert(mkdtemp(directory) != NULL);
+  write_file("pong.ch8", pong, sizeof(pong));
+  write_file("a-pong.ch8", pong, sizeof(pong));
+  write_file("maze.ch8", maze, sizeof(maze));
+  write_file(long_name, blank, sizeof(blank));
+  write_file("large.ch8", large, sizeof(large));
+  write_file(".hidden", maze, 2);
+  int length =
+      snprintf(settings, sizeof(settings), "# hash ipf seed\n%016llx 30 99\n",
+               (unsigned long long)chip8_hash_bytes(pong, sizeof(pong)));
+  write_file(ROMLIB_SETTINGS_FILE, settings, length);
+
+  // A directory is indexed, skipping what cannot be a ROM, and the index
+  // is kept for the next open.
+  CHIP8_ROMLIB* library = chip8_romlib_open(directory);
+  assert(library != NULL && library->archive == NULL);
+  check(library);
+  assert(chip8_romlib_lookup(library, long_name) != NULL);
+  assert(access(file(ROMLIB_INDEX_FILE), F_OK) == 0);
+  chip8_romlib_close(library);
+
+  // An unchanged file keeps its indexed hash without being read, so a
+  // wrong hash is reused and only caught when the ROM is loaded.
+  struct stat st;
+  assert(stat(file("maze.ch8"), &st) == 0);
+  length = snprintf(settings, sizeof(settings), "%s%016llx %lu %lld %ld %s\n",
+                    ROMLIB_INDEX_HEADER, 0x1234ULL,
+                    (unsigned long)st.st_size, (long long)st.st_mtim.tv_sec,
+                    (long)st.st_mtim.tv_nsec, "maze.ch8");
+  write_file(ROMLIB_INDEX_FILE, settings, length);
+  library = chip8_romlib_open(directory);
+  assert(library != NULL && library->count == 4);
+  assert(chip8_romlib_lookup(library, "maze.ch8")->hash == 0x1234);
+  assert(load(library, "maze.ch8") == false);
+  assert(load(library, "pong.ch8"));
+  chip8_romlib_close(library);
+
+  // A file whose size or time changed is hashed again.
+  write_file("maze.ch8", maze, sizeof(maze) - 2);
+  library = chip8_romlib_open(directory);
+  assert(library != NULL);
+  assert(chip8_romlib_lookup(library, "maze.ch8")->hash ==
+         chip8_hash_bytes(maze, sizeof(maze) - 2));
+  assert(load(library, "maze.ch8"));
+  chip8_romlib_close(library);
+  write_file("maze.ch8", maze, sizeof(maze));
+
+  // The reopened directory is packed, so its index is up to date again.
+  library = chip8_romlib_open(directory);
+  assert(library != NULL);
+  check(library);
+
+  // An archive keeps the index, names and settings.
+  char archive[PATH_MAX];
+  snprintf(archive, sizeof(archive), "%s", file("library.c8rl"));
+  assert(chip8_romlib_pack(library, archive));
+  chip8_romlib_close(library);
+
+  library = chip8_romlib_open(archive);
+  assert(library != NULL && library->archive != NULL);
+  check(library);
+  // Only the archive cuts long names
+  const CHIP8_ROM* rom = chip8_romlib_find(
+      library, chip8_hash_bytes(blank, sizeof(blank)));
+  assert(rom != NULL && strlen(rom->name) == ROMLIB_NAME_SIZE - 1);
+  assert(strncmp(rom->name, long_name, ROMLIB_NAME_SIZE - 1) == 0);
+  assert(chip8_romlib_lookup(library, rom->name) == rom);
+  chip8_romlib_close(library);
+
+  // Truncated archives are rejected.
+  assert(truncate(archive, ROMLIB_HEADER_SIZE + ROMLIB_ENTRY_SIZE) == 0);
+  assert(chip8_romlib_open(archive) == NULL);
+  assert(chip8_romlib_open(file("missing")) == NULL);
+
+  const char* names[] = {"pong.ch8",   "a-pong.ch8", "maze.ch8",
+                         long_name,    "large.ch8",  ".hidden",
+                         ROMLIB_SETTINGS_FILE,       ROMLIB_INDEX_FILE,
+                         "library.c8rl"};
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    unlink(file(names[i]));
+  }
+  rmdir(directory);
+
+  return EXIT_SUCCESS;
+}